@@ -0,0 +1,126 @@
+/**
+ * SfxrAnalysis
+ *
+ * Copyright 2010 Thomas Vian
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * @author Thomas Vian
+ */
+
+#include "SfxrAnalysis.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "Util.h"
+
+void SfxrAnalysis::fft (std::vector<std::complex<double>>& x)
+{
+    const size_t n = x.size();
+
+    for (size_t i = 1, j = 0; i < n; i++)
+    {
+        size_t bit = n >> 1;
+        for (; j & bit; bit >>= 1)
+            j ^= bit;
+        j ^= bit;
+
+        if (i < j)
+            std::swap (x[i], x[j]);
+    }
+
+    for (size_t length = 2; length <= n; length <<= 1)
+    {
+        std::complex<double> step = std::polar (1.0, -2.0 * pi / double (length));
+        for (size_t i = 0; i < n; i += length)
+        {
+            std::complex<double> w = 1.0;
+            for (size_t k = 0; k < length / 2; k++, w *= step)
+            {
+                std::complex<double> even = x[i + k], odd = x[i + k + length / 2] * w;
+                x[i + k] = even + odd;
+                x[i + k + length / 2] = even - odd;
+            }
+        }
+    }
+}
+
+namespace
+{
+    /** The Hann window and the band of each bin, worked out once */
+    struct Tables
+    {
+        std::array<double, SfxrAnalysis::frameSize> window;
+        std::array<int, SfxrAnalysis::frameSize / 2> bands {};
+
+        Tables()
+        {
+            using namespace SfxrAnalysis;
+
+            for (size_t i = 0; i < frameSize; i++)
+                window[i] = 0.5 - 0.5 * std::cos (2.0 * pi * double (i) / frameSize);
+
+            for (size_t bin = 1; bin < frameSize / 2; bin++)
+            {
+                int band = int (std::log2 (double (bin)) / std::log2 (frameSize / 2.0) * numBands);
+                bands[bin] = std::min (band, numBands - 1);
+            }
+        }
+    };
+}
+
+SfxrAnalysis::Spectrum SfxrAnalysis::getSpectrum (const float* samples, size_t numSamples, size_t length)
+{
+    static const Tables tables;
+
+    Spectrum spectrum;
+    std::vector<std::complex<double>> frame (frameSize);
+    double weightedEnergy = 0.0, totalEnergy = 0.0;
+
+    for (size_t start = 0; start < length; start += frameSize / 2)
+    {
+        for (size_t i = 0; i < frameSize; i++)
+        {
+            double sample = start + i < numSamples ? samples[start + i] : 0.0;
+            frame[i] = sample * tables.window[i];
+        }
+
+        fft (frame);
+
+        for (size_t bin = 1; bin < frameSize / 2; bin++)
+        {
+            const double energy = std::norm (frame[bin]);
+            spectrum.bands[size_t (tables.bands[bin])] += energy;
+            weightedEnergy += energy * double (bin);
+            totalEnergy += energy;
+        }
+    }
+
+    if (totalEnergy > 0.0)
+        spectrum.centroid = weightedEnergy / totalEnergy / double (frameSize);
+
+    return spectrum;
+}
+
+double SfxrAnalysis::getRms (const float* samples, size_t numSamples)
+{
+    if (numSamples == 0)
+        return 0.0;
+
+    double sumSquares = 0.0;
+    for (size_t i = 0; i < numSamples; i++)
+        sumSquares += double (samples[i]) * samples[i];
+
+    return std::sqrt (sumSquares / double (numSamples));
+}
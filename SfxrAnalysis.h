@@ -0,0 +1,55 @@
+/**
+ * SfxrAnalysis
+ *
+ * Copyright 2010 Thomas Vian
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * 	http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * @author Thomas Vian
+ */
+#pragma once
+
+#include <array>
+#include <complex>
+#include <cstddef>
+#include <vector>
+
+/**
+ * Measurements of rendered sounds, shared by SfxrVerify's comparisons and
+ * SfxrSearch's fitness functions
+ */
+namespace SfxrAnalysis
+{
+    static constexpr size_t frameSize = 1024;     // Samples in each FFT frame
+    static constexpr int numBands = 24;
+
+    struct Spectrum
+    {
+        std::array<double, numBands> bands {};  // Energy in bands spaced evenly in octaves from the first bin to Nyquist
+        double centroid = 0.0;                  // Energy weighted mean frequency, as a fraction of the sample rate
+    };
+
+    /** In place radix 2 FFT, the size must be a power of 2 */
+    void fft (std::vector<std::complex<double>>& x);
+
+    /**
+     * Measures the spectrum of a sound from Hann windowed frames overlapping by half
+     * @param	samples		Sound to measure
+     * @param	numSamples	Number of samples
+     * @param	length		Samples to measure, those past numSamples are taken to be silent
+     */
+    Spectrum getSpectrum (const float* samples, size_t numSamples, size_t length);
+
+    /** Root mean square of the samples, 0 for none */
+    double getRms (const float* samples, size_t numSamples);
+}
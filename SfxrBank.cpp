@@ -0,0 +1,492 @@
+/**
+ * SfxrBank
+ *
+ * Copyright 2010 Thomas Vian
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * @author Thomas Vian
+ */
+
+#include "SfxrBank.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstring>
+#include <mutex>
+#include <numeric>
+
+#if defined (_WIN32)
+ #define NOMINMAX
+ #include <windows.h>
+#else
+ #include <fcntl.h>
+ #include <sys/mman.h>
+ #include <sys/stat.h>
+ #include <unistd.h>
+#endif
+
+#include "SfxrBatch.h"
+#include "SfxrCache.h"
+#include "SfxrSynth.h"
+
+//--------------------------------------------------------------------------
+//
+//  Layout
+//
+//  Header, all little endian:
+//      0   "BFXB"
+//      4   u16 version
+//      6   u16 sample type, as SfxrOutputFormat::SampleType
+//      8   f32 sample rate
+//      12  u32 number of sounds
+//      16  u64 offset of the index
+//      24  u64 offset of the name order
+//      32  u64 offset of the names
+//      40  u64 size of the names
+//      48  u64 size of the file
+//      56  8 bytes reserved
+//
+//  Index entry:
+//      0   u64 patch hash
+//      8   u64 offset of the samples
+//      16  u32 number of samples
+//      20  u32 offset of the name within the names
+//      24  u32 length of the name
+//      28  4 bytes reserved
+//
+//  The name order is a u32 entry id per sound.
+//
+//--------------------------------------------------------------------------
+
+static const char bankMagic[4] = { 'B', 'F', 'X', 'B' };
+static const uint16_t bankVersion = 1;
+static const size_t headerSize = 64;
+static const size_t entrySize = 32;
+
+static void put16 (uint8_t* out, uint16_t value)
+{
+    out[0] = uint8_t (value);
+    out[1] = uint8_t (value >> 8);
+}
+
+static void put32 (uint8_t* out, uint32_t value)
+{
+    for (int i = 0; i < 4; i++)
+        out[i] = uint8_t (value >> (i * 8));
+}
+
+static void put64 (uint8_t* out, uint64_t value)
+{
+    for (int i = 0; i < 8; i++)
+        out[i] = uint8_t (value >> (i * 8));
+}
+
+static uint16_t get16 (const uint8_t* in)
+{
+    return uint16_t (in[0] | in[1] << 8);
+}
+
+static uint32_t get32 (const uint8_t* in)
+{
+    return uint32_t (in[0]) | uint32_t (in[1]) << 8 | uint32_t (in[2]) << 16 | uint32_t (in[3]) << 24;
+}
+
+static uint64_t get64 (const uint8_t* in)
+{
+    return uint64_t (get32 (in)) | uint64_t (get32 (in + 4)) << 32;
+}
+
+static size_t alignUp (size_t offset)
+{
+    return (offset + SfxrBank::alignment - 1) & ~(SfxrBank::alignment - 1);
+}
+
+/** Moves to an offset of a file, past 2 GB too */
+static bool seek (std::FILE* file, size_t offset)
+{
+#if defined (_WIN32)
+    return _fseeki64 (file, __int64 (offset), SEEK_SET) == 0;
+#else
+    return fseeko (file, off_t (offset), SEEK_SET) == 0;
+#endif
+}
+
+static size_t getSampleSize (SfxrOutputFormat::SampleType sampleType)
+{
+    SfxrOutputFormat format;
+    format.sampleType = sampleType;
+    return size_t (format.getSampleSize());
+}
+
+//--------------------------------------------------------------------------
+//
+//  Building
+//
+//--------------------------------------------------------------------------
+
+bool SfxrBank::write (const std::string& path, const std::vector<Patch>& patches, float sampleRate,
+                      SfxrOutputFormat::SampleType sampleType, unsigned int numThreads)
+{
+    const size_t count = patches.size();
+    const size_t sampleSize = getSampleSize (sampleType);
+
+    // Renders are exactly their max sample count long, so the file can be laid out before any are rendered
+    std::vector<size_t> lengths (count);
+    for (size_t i = 0; i < count; i++)
+        lengths[i] = SfxrBatch::getMaxSampleCount (patches[i].params, sampleRate);
+
+    std::vector<uint64_t> hashes (count);
+    for (size_t i = 0; i < count; i++)
+        hashes[i] = SfxrCache::hashParams (patches[i].params, sampleRate);
+
+    // Entry n of the index is patch order[n]
+    std::vector<uint32_t> order (count);
+    std::iota (order.begin(), order.end(), 0u);
+    std::stable_sort (order.begin(), order.end(), [&] (uint32_t a, uint32_t b)
+    {
+        return hashes[a] != hashes[b] ? hashes[a] < hashes[b] : patches[a].name < patches[b].name;
+    });
+
+    std::vector<uint32_t> nameOrder (count);
+    std::iota (nameOrder.begin(), nameOrder.end(), 0u);
+    std::stable_sort (nameOrder.begin(), nameOrder.end(), [&] (uint32_t a, uint32_t b)
+    {
+        return patches[order[a]].name < patches[order[b]].name;
+    });
+
+    // Lays the file out, writes everything but the samples front to back,
+    // then each sound is rendered and written in place
+    const size_t indexOffset = headerSize;
+    const size_t nameOrderOffset = indexOffset + count * entrySize;
+    const size_t namesOffset = nameOrderOffset + count * 4;
+
+    std::vector<uint8_t> index (count * entrySize, 0), names;
+    std::vector<size_t> sampleOffsets (count);      // Of each patch, in the order given
+
+    for (size_t id = 0; id < count; id++)
+    {
+        const Patch& patch = patches[order[id]];
+        uint8_t* entry = index.data() + id * entrySize;
+
+        put64 (entry, hashes[order[id]]);
+        put32 (entry + 16, uint32_t (lengths[order[id]]));
+        put32 (entry + 20, uint32_t (names.size()));
+        put32 (entry + 24, uint32_t (patch.name.size()));
+        names.insert (names.end(), patch.name.begin(), patch.name.end());
+    }
+
+    size_t offset = alignUp (namesOffset + names.size());
+    for (size_t id = 0; id < count; id++)
+    {
+        sampleOffsets[order[id]] = offset;
+        put64 (index.data() + id * entrySize + 8, offset);
+        offset = alignUp (offset + lengths[order[id]] * sampleSize);
+    }
+
+    const size_t fileSize = offset;
+
+    uint8_t header[headerSize] = {};
+    std::memcpy (header, bankMagic, 4);
+    put16 (header + 4, bankVersion);
+    put16 (header + 6, uint16_t (sampleType));
+    uint32_t rateBits;
+    std::memcpy (&rateBits, &sampleRate, 4);
+    put32 (header + 8, rateBits);
+    put32 (header + 12, uint32_t (count));
+    put64 (header + 16, indexOffset);
+    put64 (header + 24, nameOrderOffset);
+    put64 (header + 32, namesOffset);
+    put64 (header + 40, names.size());
+    put64 (header + 48, fileSize);
+
+    std::vector<uint8_t> nameOrderBytes (count * 4);
+    for (size_t i = 0; i < count; i++)
+        put32 (nameOrderBytes.data() + i * 4, nameOrder[i]);
+
+    std::FILE* file = std::fopen (path.c_str(), "wb");
+    if (file == nullptr)
+        return false;
+
+    std::fwrite (header, 1, headerSize, file);
+    std::fwrite (index.data(), 1, index.size(), file);
+    std::fwrite (nameOrderBytes.data(), 1, nameOrderBytes.size(), file);
+    std::fwrite (names.data(), 1, names.size(), file);
+
+    // Sizes the file, the padding between the sounds is left as the zeros this fills in
+    const size_t position = namesOffset + names.size();
+    if (fileSize > position && (! seek (file, fileSize - 1) || std::fputc (0, file) == EOF))
+    {
+        std::fclose (file);
+        return false;
+    }
+
+    SfxrOutputFormat format;
+    format.sampleType = sampleType;
+
+    std::mutex fileLock;
+    std::atomic<bool> written (std::ferror (file) == 0);
+
+    SfxrBatch batch (numThreads);
+    batch.run (lengths, [&] (size_t i)
+    {
+        constexpr int blockFrames = 4096;
+        std::vector<uint8_t> block (size_t (blockFrames) * sampleSize);
+
+        SfxrSynth synth (sampleRate);
+        synth.setSeed (patches[i].seed);
+        synth.setParams (patches[i].params);
+        synth.reset (true);
+
+        size_t soundOffset = sampleOffsets[i];
+        for (size_t remaining = lengths[i]; remaining > 0 && written;)
+        {
+            const int frames = synth.render (block.data(), int (std::min (remaining, size_t (blockFrames))), format);
+            if (frames == 0)
+                break;
+
+            const size_t numBytes = size_t (frames) * sampleSize;
+            {
+                std::lock_guard<std::mutex> guard (fileLock);
+                if (! seek (file, soundOffset) || std::fwrite (block.data(), 1, numBytes, file) != numBytes)
+                    written = false;
+            }
+
+            soundOffset += numBytes;
+            remaining -= size_t (frames);
+        }
+    });
+
+    bool ok = written && std::ferror (file) == 0;
+    return std::fclose (file) == 0 && ok;
+}
+
+//--------------------------------------------------------------------------
+//
+//  Loading
+//
+//--------------------------------------------------------------------------
+
+SfxrBank::~SfxrBank()
+{
+    close();
+}
+
+bool SfxrBank::open (const std::string& path)
+{
+    close();
+
+#if defined (_WIN32)
+    HANDLE file = CreateFileA (path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE)
+        return false;
+
+    LARGE_INTEGER fileSize;
+    HANDLE mapping = GetFileSizeEx (file, &fileSize) && fileSize.QuadPart > 0
+                   ? CreateFileMappingA (file, nullptr, PAGE_READONLY, 0, 0, nullptr) : nullptr;
+    CloseHandle (file);
+
+    if (mapping == nullptr)
+        return false;
+
+    void* view = MapViewOfFile (mapping, FILE_MAP_READ, 0, 0, 0);
+    if (view == nullptr)
+    {
+        CloseHandle (mapping);
+        return false;
+    }
+
+    const size_t size = size_t (fileSize.QuadPart);
+    _mappingHandle = mapping;
+#else
+    int file = ::open (path.c_str(), O_RDONLY);
+    if (file < 0)
+        return false;
+
+    struct stat info;
+    void* view = fstat (file, &info) == 0 && info.st_size > 0
+               ? mmap (nullptr, size_t (info.st_size), PROT_READ, MAP_PRIVATE, file, 0) : MAP_FAILED;
+    ::close (file);
+
+    if (view == MAP_FAILED)
+        return false;
+
+    const size_t size = size_t (info.st_size);
+#endif
+
+    _mapping = view;
+    _size = size;
+
+    if (! readHeader (static_cast<const uint8_t*> (view), size))
+    {
+        close();
+        return false;
+    }
+    return true;
+}
+
+bool SfxrBank::open (const void* data, size_t size)
+{
+    close();
+
+    if (data == nullptr || ! readHeader (static_cast<const uint8_t*> (data), size))
+    {
+        close();
+        return false;
+    }
+    return true;
+}
+
+void SfxrBank::close()
+{
+    if (_mapping != nullptr)
+    {
+       #if defined (_WIN32)
+        UnmapViewOfFile (_mapping);
+        CloseHandle (_mappingHandle);
+       #else
+        munmap (_mapping, _size);
+       #endif
+    }
+
+    _data = nullptr;
+    _size = 0;
+    _mapping = nullptr;
+    _mappingHandle = nullptr;
+    _numSounds = 0;
+    _index = _nameOrder = _names = nullptr;
+    _namesSize = 0;
+}
+
+bool SfxrBank::readHeader (const uint8_t* data, size_t size)
+{
+    if (size < headerSize || std::memcmp (data, bankMagic, 4) != 0 || get16 (data + 4) != bankVersion)
+        return false;
+
+    const uint16_t sampleType = get16 (data + 6);
+    const uint64_t numSounds = get32 (data + 12);
+    const uint64_t indexOffset = get64 (data + 16);
+    const uint64_t nameOrderOffset = get64 (data + 24);
+    const uint64_t namesOffset = get64 (data + 32);
+    const uint64_t namesSize = get64 (data + 40);
+
+    // Offsets are checked against the size before adding, so damaged ones can't overflow
+    if (sampleType > SfxrOutputFormat::int24 || get64 (data + 48) != size
+        || indexOffset > size || (size - indexOffset) / entrySize < numSounds
+        || nameOrderOffset > size || (size - nameOrderOffset) / 4 < numSounds
+        || namesOffset > size || size - namesOffset < namesSize)
+        return false;
+
+    const uint32_t rateBits = get32 (data + 8);
+    std::memcpy (&_sampleRate, &rateBits, 4);
+
+    _data = data;
+    _size = size;
+    _numSounds = uint32_t (numSounds);
+    _sampleType = SfxrOutputFormat::SampleType (sampleType);
+    _index = data + indexOffset;
+    _nameOrder = data + nameOrderOffset;
+    _names = data + namesOffset;
+    _namesSize = size_t (namesSize);
+    return true;
+}
+
+//--------------------------------------------------------------------------
+//
+//  Getters
+//
+//--------------------------------------------------------------------------
+
+const uint8_t* SfxrBank::getEntry (uint32_t id) const
+{
+    return id < _numSounds ? _index + size_t (id) * entrySize : nullptr;
+}
+
+uint32_t SfxrBank::find (uint64_t hash) const
+{
+    uint32_t low = 0, high = _numSounds;
+    while (low < high)
+    {
+        const uint32_t middle = low + (high - low) / 2;
+        if (get64 (getEntry (middle)) < hash)
+            low = middle + 1;
+        else
+            high = middle;
+    }
+
+    return low < _numSounds && get64 (getEntry (low)) == hash ? low : notFound;
+}
+
+uint32_t SfxrBank::find (const SfxrParams& params) const
+{
+    return find (SfxrCache::hashParams (params, _sampleRate));
+}
+
+uint32_t SfxrBank::find (std::string_view name) const
+{
+    uint32_t low = 0, high = _numSounds;
+    while (low < high)
+    {
+        const uint32_t middle = low + (high - low) / 2;
+        if (getName (get32 (_nameOrder + size_t (middle) * 4)) < name)
+            low = middle + 1;
+        else
+            high = middle;
+    }
+
+    if (low == _numSounds)
+        return notFound;
+
+    const uint32_t id = get32 (_nameOrder + size_t (low) * 4);
+    return getName (id) == name ? id : notFound;
+}
+
+uint64_t SfxrBank::getHash (uint32_t id) const
+{
+    const uint8_t* entry = getEntry (id);
+    return entry != nullptr ? get64 (entry) : 0;
+}
+
+std::string_view SfxrBank::getName (uint32_t id) const
+{
+    const uint8_t* entry = getEntry (id);
+    if (entry == nullptr)
+        return {};
+
+    const size_t offset = get32 (entry + 20), length = get32 (entry + 24);
+    if (offset > _namesSize || _namesSize - offset < length)
+        return {};
+
+    return std::string_view (reinterpret_cast<const char*> (_names + offset), length);
+}
+
+SfxrBank::Sound SfxrBank::getSound (uint32_t id) const
+{
+    const uint8_t* entry = getEntry (id);
+    if (entry == nullptr)
+        return {};
+
+    const uint64_t offset = get64 (entry + 8);
+    const uint64_t numSamples = get32 (entry + 16);
+    const uint64_t numBytes = numSamples * getSampleSize (_sampleType);
+
+    if (offset > _size || _size - offset < numBytes)
+        return {};
+
+    Sound sound;
+    sound.data = _data + offset;
+    sound.numSamples = size_t (numSamples);
+    sound.numBytes = size_t (numBytes);
+    return sound;
+}
@@ -0,0 +1,178 @@
+/**
+ * SfxrBank
+ *
+ * Copyright 2010 Thomas Vian
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * 	http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * @author Thomas Vian
+ */
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "SfxrOutputFormat.h"
+#include "SfxrParams.h"
+
+/**
+ * A file of pre-rendered sounds, memory mapped and read in place
+ *
+ * The file holds a 64 byte header, an index of the sounds sorted by patch
+ * hash then name, a table of the sounds in name order, the names, and the
+ * samples of each sound starting on a 64 byte boundary. Opening a bank maps
+ * it and checks the header, so it costs the same however many sounds it
+ * holds, and the samples are paged in the first time each sound is used.
+ *
+ * Hashes are SfxrCache::hashParams of the patch at the bank's sample rate.
+ * Samples are mono, in the little endian form SfxrOutputFormat writes.
+ */
+class SfxrBank
+{
+public:
+    /** A sound to put in a bank */
+    struct Patch
+    {
+        std::string name;
+        SfxrParams params;
+        uint64_t seed = 0;                    // Noise seed the sound is rendered with
+    };
+
+    /** Samples of a sound, pointing into the mapped file */
+    struct Sound
+    {
+        const void* data = nullptr;           // First sample, in the bank's sample type
+        size_t numSamples = 0;
+        size_t numBytes = 0;
+
+        explicit operator bool() const
+        {
+            return data != nullptr;
+        }
+    };
+
+    static constexpr uint32_t notFound = UINT32_MAX;
+    static constexpr size_t alignment = 64;   // Of each sound's samples within the file
+
+    SfxrBank() = default;
+    ~SfxrBank();
+
+    SfxrBank (const SfxrBank&) = delete;
+    SfxrBank& operator= (const SfxrBank&) = delete;
+
+    //--------------------------------------------------------------------------
+    //
+    //  Building
+    //
+    //--------------------------------------------------------------------------
+
+    /**
+     * Renders patches and writes them to a bank
+     * Each sound is rendered and written in place a block at a time, so
+     * memory doesn't grow with the number or length of the sounds
+     * @param	path		File to write
+     * @param	patches		Sounds to render, names needn't be unique
+     * @param	sampleRate	Sample rate to render at
+     * @param	sampleType	Type the samples are stored as
+     * @param	numThreads	Threads to render on, 0 for one per core
+     * @return				False if the file can't be written
+     */
+    static bool write (const std::string& path, const std::vector<Patch>& patches, float sampleRate = 44100.0f,
+                       SfxrOutputFormat::SampleType sampleType = SfxrOutputFormat::float32, unsigned int numThreads = 0);
+
+    //--------------------------------------------------------------------------
+    //
+    //  Loading
+    //
+    //--------------------------------------------------------------------------
+
+    /** Maps a bank file, closing the open bank first, returns false if it can't be mapped or isn't a bank */
+    bool open (const std::string& path);
+
+    /**
+     * Reads a bank already in memory, which must stay valid until the bank is closed
+     * The data should be 64 byte aligned for the samples to be
+     */
+    bool open (const void* data, size_t size);
+
+    /** Unmaps the bank, any sounds returned from it are no longer valid */
+    void close();
+
+    bool isOpen() const
+    {
+        return _data != nullptr;
+    }
+
+    //--------------------------------------------------------------------------
+    //
+    //  Getters
+    //
+    //--------------------------------------------------------------------------
+
+    uint32_t getNumSounds() const
+    {
+        return _numSounds;
+    }
+
+    float getSampleRate() const
+    {
+        return _sampleRate;
+    }
+
+    SfxrOutputFormat::SampleType getSampleType() const
+    {
+        return _sampleType;
+    }
+
+    /** Returns the id of the first sound with a patch hash, or notFound */
+    uint32_t find (uint64_t hash) const;
+
+    /** Returns the id of the sound rendered from params at the bank's sample rate, or notFound */
+    uint32_t find (const SfxrParams& params) const;
+
+    /** Returns the id of the first sound with a name, or notFound */
+    uint32_t find (std::string_view name) const;
+
+    uint64_t getHash (uint32_t id) const;
+
+    /** Returns the name of a sound, empty for an invalid id */
+    std::string_view getName (uint32_t id) const;
+
+    /**
+     * Returns the samples of a sound, without copying them
+     * Returns an empty sound for an invalid id or a damaged entry
+     */
+    Sound getSound (uint32_t id) const;
+
+private:
+    /** Checks the header and takes the layout from it, returns false if it isn't a bank */
+    bool readHeader (const uint8_t* data, size_t size);
+
+    const uint8_t* getEntry (uint32_t id) const;
+
+    const uint8_t* _data = nullptr;           // Start of the bank, null when closed
+    size_t _size = 0;
+    void* _mapping = nullptr;                 // Mapped view, null when reading the caller's memory
+    void* _mappingHandle = nullptr;           // File mapping object on Windows
+
+    uint32_t _numSounds = 0;
+    float _sampleRate = 0.0f;
+    SfxrOutputFormat::SampleType _sampleType = SfxrOutputFormat::float32;
+    const uint8_t* _index = nullptr;          // Entries sorted by hash then name
+    const uint8_t* _nameOrder = nullptr;      // Entry ids sorted by name
+    const uint8_t* _names = nullptr;
+    size_t _namesSize = 0;
+};
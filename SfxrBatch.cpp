@@ -0,0 +1,313 @@
+/**
+ * SfxrBatch
+ *
+ * Copyright 2010 Thomas Vian
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * @author Thomas Vian
+ */
+
+#include "SfxrBatch.h"
+
+#include <algorithm>
+#include <cmath>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <mutex>
+#include <numeric>
+#include <thread>
+
+#include "SfxrPatch.h"
+#include "SfxrSynth.h"
+
+//--------------------------------------------------------------------------
+//
+//  Pool
+//
+//--------------------------------------------------------------------------
+
+/**
+ * Work stealing thread pool
+ * Each worker takes jobs from the front of its own queue and, once that is
+ * empty, steals from the back of the others. The calling thread is worker 0.
+ */
+class SfxrBatch::Pool
+{
+public:
+    explicit Pool (unsigned int numThreads)
+    {
+        for (unsigned int i = 0; i < numThreads; i++)
+            _queues.push_back (std::make_unique<Queue>());
+
+        for (unsigned int i = 1; i < numThreads; i++)
+            _threads.emplace_back ([this, i] { workerLoop (i); });
+    }
+
+    ~Pool()
+    {
+        {
+            std::lock_guard<std::mutex> lock (_lock);
+            _quit = true;
+        }
+        _wake.notify_all();
+
+        for (auto& thread : _threads)
+            thread.join();
+    }
+
+    unsigned int getNumThreads() const
+    {
+        return unsigned (_queues.size());
+    }
+
+    /**
+     * Runs the job for each index in order, which is dealt out to the workers in turn
+     * If a job throws, the jobs not yet started are dropped and the first
+     * exception is rethrown once every worker has stopped.
+     * @param	order		Indices to run, the first ones are started first
+     * @param	job			Job to run for each index
+     */
+    void run (const std::vector<size_t>& order, const Job& job)
+    {
+        std::lock_guard<std::mutex> runLock (_runLock);
+
+        for (size_t i = 0; i < order.size(); i++)
+            _queues[i % _queues.size()]->jobs.push_back (order[i]);
+
+        {
+            std::lock_guard<std::mutex> lock (_lock);
+            _job = &job;
+            _busy = _threads.size();
+            _generation++;
+        }
+        _wake.notify_all();
+
+        work (0);
+
+        std::exception_ptr exception;
+        {
+            std::unique_lock<std::mutex> lock (_lock);
+            _done.wait (lock, [this] { return _busy == 0; });
+            _job = nullptr;
+            std::swap (exception, _exception);
+        }
+
+        if (exception != nullptr)
+            std::rethrow_exception (exception);
+    }
+
+private:
+    struct Queue
+    {
+        std::mutex lock;
+        std::deque<size_t> jobs;
+    };
+
+    void workerLoop (size_t worker)
+    {
+        uint64_t generation = 0;
+
+        for (;;)
+        {
+            {
+                std::unique_lock<std::mutex> lock (_lock);
+                _wake.wait (lock, [&] { return _quit || _generation != generation; });
+                if (_quit)
+                    return;
+                generation = _generation;
+            }
+
+            work (worker);
+
+            std::lock_guard<std::mutex> lock (_lock);
+            if (--_busy == 0)
+                _done.notify_one();
+        }
+    }
+
+    /** Runs jobs until every queue is empty, no jobs are added while running */
+    void work (size_t worker)
+    {
+        size_t index;
+        while (takeJob (worker, index))
+        {
+            try
+            {
+                (*_job) (index);
+            }
+            catch (...)
+            {
+                fail (std::current_exception());
+            }
+        }
+    }
+
+    /** Keeps the first exception of the batch and drops the jobs not yet started */
+    void fail (std::exception_ptr exception)
+    {
+        {
+            std::lock_guard<std::mutex> lock (_lock);
+            if (_exception == nullptr)
+                _exception = exception;
+        }
+
+        for (auto& queue : _queues)
+        {
+            std::lock_guard<std::mutex> lock (queue->lock);
+            queue->jobs.clear();
+        }
+    }
+
+    bool takeJob (size_t worker, size_t& index)
+    {
+        {
+            Queue& own = *_queues[worker];
+            std::lock_guard<std::mutex> lock (own.lock);
+            if (! own.jobs.empty())
+            {
+                index = own.jobs.front();
+                own.jobs.pop_front();
+                return true;
+            }
+        }
+
+        for (size_t i = 1; i < _queues.size(); i++)
+        {
+            Queue& victim = *_queues[(worker + i) % _queues.size()];
+            std::lock_guard<std::mutex> lock (victim.lock);
+            if (! victim.jobs.empty())
+            {
+                index = victim.jobs.back();
+                victim.jobs.pop_back();
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+    std::vector<std::unique_ptr<Queue>> _queues;  // One queue per worker
+    std::vector<std::thread> _threads;        // Workers 1 and up
+
+    std::mutex _runLock;                      // Only one batch runs at a time
+    std::mutex _lock;                         // Guards the variables below
+    std::condition_variable _wake;            // Starts the workers on a new batch
+    std::condition_variable _done;            // Signals the last worker finishing
+    const Job* _job = nullptr;                // Job of the current batch
+    std::exception_ptr _exception;            // First exception thrown by a job of the current batch
+    uint64_t _generation = 0;                 // Number of batches started
+    size_t _busy = 0;                         // Workers still running the current batch
+    bool _quit = false;                       // Stops the workers
+};
+
+//--------------------------------------------------------------------------
+//
+//  SfxrBatch
+//
+//--------------------------------------------------------------------------
+
+SfxrBatch::SfxrBatch (unsigned int numThreads)
+    : _seed (SfxrRandom::getUniqueSeed())
+{
+    if (numThreads == 0)
+        numThreads = std::max (1u, std::thread::hardware_concurrency());
+
+    _pool = std::make_unique<Pool> (numThreads);
+}
+
+SfxrBatch::SfxrBatch (Executor executor)
+    : _executor (std::move (executor)), _seed (SfxrRandom::getUniqueSeed())
+{
+}
+
+SfxrBatch::~SfxrBatch() = default;
+
+unsigned int SfxrBatch::getNumThreads() const
+{
+    return _pool != nullptr ? _pool->getNumThreads() : 0;
+}
+
+std::vector<std::vector<float>> SfxrBatch::render (const SfxrParams* params, size_t count, float sampleRate)
+{
+    std::vector<std::vector<float>> buffers (count);
+
+    std::vector<size_t> lengths (count);
+    for (size_t i = 0; i < count; i++)
+        lengths[i] = getMaxSampleCount (params[i], sampleRate);
+
+    uint64_t seed = _seed;
+    run (lengths, [&] (size_t index)
+    {
+        buffers[index] = renderSound (params[index], sampleRate, seed + index, _trimSilence, _silenceThreshold);
+    });
+
+    return buffers;
+}
+
+void SfxrBatch::run (const std::vector<size_t>& lengths, const Job& job)
+{
+    // Longest sounds first, so the short ones fill in the gaps at the end
+    std::vector<size_t> order (lengths.size());
+    std::iota (order.begin(), order.end(), size_t (0));
+    std::stable_sort (order.begin(), order.end(), [&] (size_t a, size_t b) { return lengths[a] > lengths[b]; });
+
+    if (_pool != nullptr)
+        _pool->run (order, job);
+    else if (_executor)
+        _executor (order.size(), [&] (size_t n) { job (order[n]); });
+}
+
+std::vector<float> SfxrBatch::renderSound (const SfxrParams& params, float sampleRate, uint64_t seed, bool trimSilence, float threshold)
+{
+    SfxrSynth synth (sampleRate);
+    synth.setSeed (seed);
+    synth.setParams (params);
+    synth.setFinishOnSilence (trimSilence);
+    synth.setSilenceThreshold (threshold);
+
+    std::vector<float> buffer (synth.getSampleCount(), 0.0f);
+
+    synth.reset (true);
+    buffer.resize (size_t (synth.render (buffer.data(), int (buffer.size()))));
+
+    if (trimSilence)
+        SfxrBatch::trimSilence (buffer, threshold);
+
+    return buffer;
+}
+
+size_t SfxrBatch::getMaxSampleCount (const SfxrParams& params, float sampleRate)
+{
+    size_t length = SfxrPatch::compile (params).getSampleCount();
+
+    if (sampleRate != SfxrSynth::internalSampleRate)
+        length = SfxrResampler::getOutputLength (length, SfxrSynth::internalSampleRate, sampleRate);
+
+    return length;
+}
+
+size_t SfxrBatch::trimSilence (std::vector<float>& samples, float threshold, bool leading)
+{
+    auto isSilent = [threshold] (float sample) { return std::abs (sample) <= threshold; };
+
+    samples.erase (std::find_if_not (samples.rbegin(), samples.rend(), isSilent).base(), samples.end());
+
+    if (! leading)
+        return 0;
+
+    size_t start = size_t (std::find_if_not (samples.begin(), samples.end(), isSilent) - samples.begin());
+    samples.erase (samples.begin(), samples.begin() + std::ptrdiff_t (start));
+    return start;
+}
@@ -0,0 +1,164 @@
+/**
+ * SfxrBatch
+ *
+ * Copyright 2010 Thomas Vian
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * @author Thomas Vian
+ */
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <vector>
+
+#include "SfxrParams.h"
+
+/**
+ * Renders many sounds at once, one buffer per set of params
+ *
+ * Sounds are rendered either on the batch's own work stealing thread pool or
+ * on an executor supplied by the caller. Sounds are handed out longest first
+ * and idle threads steal from busy ones, so a few long explosions and many
+ * short blips still keep every core busy.
+ */
+class SfxrBatch
+{
+public:
+    /** Renders one sound, called with each index from 0 up to the count */
+    typedef std::function<void (size_t)> Job;
+
+    /**
+     * Runs a job for every index from 0 up to count, in any order and on any
+     * threads, and returns once they have all finished
+     */
+    typedef std::function<void (size_t count, const Job& job)> Executor;
+
+    /**
+     * Renders on a thread pool owned by the batch
+     * @param	numThreads	Threads to render on, including the calling thread, 0 for one per core
+     */
+    explicit SfxrBatch (unsigned int numThreads = 0);
+
+    /** Renders on an executor supplied by the caller */
+    explicit SfxrBatch (Executor executor);
+
+    ~SfxrBatch();
+
+    SfxrBatch (const SfxrBatch&) = delete;
+    SfxrBatch& operator= (const SfxrBatch&) = delete;
+
+    //--------------------------------------------------------------------------
+    //
+    //  Getters / Setters
+    //
+    //--------------------------------------------------------------------------
+
+    /** Threads the pool renders on, 0 when an executor is used */
+    unsigned int getNumThreads() const;
+
+    /**
+     * Sets the seed of the noise waves
+     * Sound n is rendered with seed + n, so a batch always renders the same way
+     */
+    void setSeed (uint64_t seed)
+    {
+        _seed = seed;
+    }
+
+    uint64_t getSeed() const
+    {
+        return _seed;
+    }
+    
+    /**
+     * Sets whether render cuts the silence from the sounds
+     * Each sound finishes at its first sample of lasting silence, see
+     * SfxrSynth::setFinishOnSilence, and samples no louder than the threshold
+     * are trimmed from its start and end.
+     */
+    void setTrimSilence (bool enabled, float threshold = 0.0f)
+    {
+        _trimSilence = enabled;
+        _silenceThreshold = threshold;
+    }
+    
+    bool getTrimSilence() const
+    {
+        return _trimSilence;
+    }
+
+    //--------------------------------------------------------------------------
+    //
+    //  Render Methods
+    //
+    //--------------------------------------------------------------------------
+
+    /**
+     * Renders each set of params to its own buffer
+     * Safe to call from one thread at a time, and throws as run does
+     * @param	params		Sounds to render
+     * @param	count		Number of sounds
+     * @param	sampleRate	Sample rate passed to each SfxrSynth
+     * @return				One buffer per sound, in the same order as the params
+     */
+    std::vector<std::vector<float>> render (const SfxrParams* params, size_t count, float sampleRate = 44100.0f);
+
+    std::vector<std::vector<float>> render (const std::vector<SfxrParams>& params, float sampleRate = 44100.0f)
+    {
+        return render (params.data(), params.size(), sampleRate);
+    }
+
+    /**
+     * Runs a job for each index on the batch's threads, longest first
+     * For sounds rendered some other way than into buffers, such as streamed to files.
+     * On the batch's own pool, if a job throws the jobs not yet started are
+     * skipped and the first exception is rethrown once every thread has
+     * stopped. On an executor, exceptions are left to the executor.
+     * @param	lengths		Expected length of the sound at each index
+     * @param	job			Job to run for each index
+     */
+    void run (const std::vector<size_t>& lengths, const Job& job);
+
+    /**
+     * Renders a single sound on the calling thread
+     * The buffer is allocated once, at the exact length of the sound
+     * @param	trimSilence	If the silence is cut from the sound, as by setTrimSilence
+     * @param	threshold	Level no louder than which counts as silence
+     */
+    static std::vector<float> renderSound (const SfxrParams& params, float sampleRate, uint64_t seed,
+                                           bool trimSilence = false, float threshold = 0.0f);
+
+    /**
+     * Number of samples a sound renders at the sample rate, exact unless its silence is trimmed
+     * Same as SfxrSynth::getSampleCount
+     */
+    static size_t getMaxSampleCount (const SfxrParams& params, float sampleRate = 44100.0f);
+
+    /**
+     * Removes the samples no louder than threshold from the end and, if leading, the start of a sound
+     * @return				Number of samples removed from the start
+     */
+    static size_t trimSilence (std::vector<float>& samples, float threshold = 0.0f, bool leading = true);
+
+private:
+    class Pool;
+
+    std::unique_ptr<Pool> _pool;              // Own thread pool, null when an executor is used
+    Executor _executor;                       // Caller's executor
+    uint64_t _seed;                           // Seed of the first sound
+    bool _trimSilence = false;                // If render cuts the silence from the sounds
+    float _silenceThreshold = 0.0f;
+};
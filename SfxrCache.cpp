@@ -0,0 +1,234 @@
+/**
+ * SfxrCache
+ *
+ * Copyright 2010 Thomas Vian
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * @author Thomas Vian
+ */
+
+#include "SfxrCache.h"
+
+#include <cmath>
+#include <cstring>
+
+#include "SfxrBatch.h"
+
+//--------------------------------------------------------------------------
+//
+//  Hashing
+//
+//--------------------------------------------------------------------------
+
+/** Rounds each param to the quantization step, keeping it in range */
+static float quantize (const SfxrParams& params, ParamId param, float quantization)
+{
+    float value = params.getParam (param);
+    if (quantization <= 0.0f || param == ParamId::waveType)
+        return value;
+
+    value = std::round (value / quantization) * quantization;
+    return SfxrParams::clamp (value, params.getMin (param), params.getMax (param));
+}
+
+/** FNV-1a over the bits of a value, -0 is hashed as 0 */
+static uint64_t hashBits (uint64_t hash, float value)
+{
+    if (value == 0.0f)
+        value = 0.0f;
+
+    uint32_t bits;
+    std::memcpy (&bits, &value, sizeof (bits));
+
+    for (int i = 0; i < 4; i++)
+    {
+        hash ^= (bits >> (i * 8)) & 0xff;
+        hash *= 0x100000001b3ull;
+    }
+    return hash;
+}
+
+uint64_t SfxrCache::hashParams (const SfxrParams& params, float sampleRate, float quantization)
+{
+    uint64_t hash = 0xcbf29ce484222325ull;
+
+    for (size_t i = 0; i < size_t (ParamId::count); i++)
+        hash = hashBits (hash, quantize (params, ParamId (i), quantization));
+
+    return hashBits (hash, sampleRate);
+}
+
+SfxrCache::Key SfxrCache::makeKey (const SfxrParams& params, float sampleRate, float quantization, uint64_t seed)
+{
+    Key key;
+
+    for (size_t i = 0; i < size_t (ParamId::count); i++)
+    {
+        key.values[i] = quantize (params, ParamId (i), quantization);
+        if (key.values[i] == 0.0f)
+            key.values[i] = 0.0f;
+    }
+
+    key.sampleRate = sampleRate;
+    key.seed = seed;
+    key.hash = hashParams (params, sampleRate, quantization) ^ (seed * 0x9e3779b97f4a7c15ull);
+    return key;
+}
+
+size_t SfxrCache::getBytes (const Buffer& buffer)
+{
+    return buffer->size() * sizeof (float);
+}
+
+//--------------------------------------------------------------------------
+//
+//  Getters / Setters
+//
+//--------------------------------------------------------------------------
+
+SfxrCache::SfxrCache (size_t byteBudget)
+    : _byteBudget (byteBudget)
+{
+}
+
+void SfxrCache::setByteBudget (size_t byteBudget)
+{
+    std::lock_guard<std::mutex> lock (_lock);
+    _byteBudget = byteBudget;
+    evict();
+}
+
+size_t SfxrCache::getByteBudget() const
+{
+    std::lock_guard<std::mutex> lock (_lock);
+    return _byteBudget;
+}
+
+void SfxrCache::setQuantization (float step)
+{
+    std::lock_guard<std::mutex> lock (_lock);
+    _quantization = step;
+}
+
+float SfxrCache::getQuantization() const
+{
+    std::lock_guard<std::mutex> lock (_lock);
+    return _quantization;
+}
+
+void SfxrCache::setSeed (uint64_t seed)
+{
+    std::lock_guard<std::mutex> lock (_lock);
+    _seed = seed;
+}
+
+uint64_t SfxrCache::getSeed() const
+{
+    std::lock_guard<std::mutex> lock (_lock);
+    return _seed;
+}
+
+SfxrCache::Stats SfxrCache::getStats() const
+{
+    std::lock_guard<std::mutex> lock (_lock);
+    return _stats;
+}
+
+void SfxrCache::resetStats()
+{
+    std::lock_guard<std::mutex> lock (_lock);
+    _stats.hits = 0;
+    _stats.misses = 0;
+    _stats.evictions = 0;
+}
+
+//--------------------------------------------------------------------------
+//
+//  Cache Methods
+//
+//--------------------------------------------------------------------------
+
+SfxrCache::Buffer SfxrCache::get (const SfxrParams& params, float sampleRate)
+{
+    Key key;
+    {
+        std::lock_guard<std::mutex> lock (_lock);
+        key = makeKey (params, sampleRate, _quantization, _seed);
+
+        auto found = _index.find (key);
+        if (found != _index.end())
+        {
+            _entries.splice (_entries.begin(), _entries, found->second);
+            _stats.hits++;
+            return found->second->buffer;
+        }
+        _stats.misses++;
+    }
+
+    // Renders without the lock, from the rounded values so every patch sharing the key sounds the same
+    SfxrParams rounded = params;
+    for (size_t i = 0; i < size_t (ParamId::count); i++)
+        rounded.setParam (ParamId (i), key.values[i]);
+
+    auto buffer = std::make_shared<const std::vector<float>> (SfxrBatch::renderSound (rounded, sampleRate, key.seed));
+
+    std::lock_guard<std::mutex> lock (_lock);
+
+    // Another thread may have rendered the same sound meanwhile
+    auto found = _index.find (key);
+    if (found != _index.end())
+    {
+        _entries.splice (_entries.begin(), _entries, found->second);
+        return found->second->buffer;
+    }
+
+    if (getBytes (buffer) > _byteBudget)
+        return buffer;
+
+    _entries.push_front ({key, buffer});
+    _index.emplace (key, _entries.begin());
+    _stats.bytes += getBytes (buffer);
+    _stats.entries++;
+    evict();
+
+    return buffer;
+}
+
+bool SfxrCache::contains (const SfxrParams& params, float sampleRate) const
+{
+    std::lock_guard<std::mutex> lock (_lock);
+    return _index.count (makeKey (params, sampleRate, _quantization, _seed)) != 0;
+}
+
+void SfxrCache::clear()
+{
+    std::lock_guard<std::mutex> lock (_lock);
+    _entries.clear();
+    _index.clear();
+    _stats.bytes = 0;
+    _stats.entries = 0;
+}
+
+void SfxrCache::evict()
+{
+    while (_stats.bytes > _byteBudget && ! _entries.empty())
+    {
+        Entry& oldest = _entries.back();
+        _stats.bytes -= getBytes (oldest.buffer);
+        _stats.entries--;
+        _stats.evictions++;
+        _index.erase (oldest.key);
+        _entries.pop_back();
+    }
+}
@@ -0,0 +1,151 @@
+/**
+ * SfxrCache
+ *
+ * Copyright 2010 Thomas Vian
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * @author Thomas Vian
+ */
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+#include "SfxrParams.h"
+
+/**
+ * Keeps rendered sounds in memory so repeated triggers cost a lookup
+ *
+ * Sounds are keyed by a stable hash of their parameter values, the sample
+ * rate and the noise seed. Parameters can be quantized first so nearly
+ * identical patches share an entry. The least recently used sounds are
+ * evicted once the buffers go over the byte budget.
+ * All methods are thread safe.
+ */
+class SfxrCache
+{
+public:
+    typedef std::shared_ptr<const std::vector<float>> Buffer;
+
+    struct Stats
+    {
+        uint64_t hits = 0;                    // Sounds found in the cache
+        uint64_t misses = 0;                  // Sounds rendered
+        uint64_t evictions = 0;               // Sounds evicted to stay under the budget
+        size_t bytes = 0;                     // Bytes of samples held
+        size_t entries = 0;                   // Sounds held
+    };
+
+    /** @param	byteBudget	Most bytes of samples to hold */
+    explicit SfxrCache (size_t byteBudget = 64 * 1024 * 1024);
+
+    //--------------------------------------------------------------------------
+    //
+    //  Getters / Setters
+    //
+    //--------------------------------------------------------------------------
+
+    /** Sets the byte budget, evicting sounds if it has shrunk */
+    void setByteBudget (size_t byteBudget);
+    size_t getByteBudget() const;
+
+    /**
+     * Sets the step parameters are rounded to before hashing, 0 for none
+     * Sounds are rendered from the rounded params, so an entry does not depend
+     * on which of its patches was requested first. The wave type is never rounded.
+     */
+    void setQuantization (float step);
+    float getQuantization() const;
+
+    /** Sets the seed every sound's noise is rendered with */
+    void setSeed (uint64_t seed);
+    uint64_t getSeed() const;
+
+    Stats getStats() const;
+    void resetStats();
+
+    //--------------------------------------------------------------------------
+    //
+    //  Cache Methods
+    //
+    //--------------------------------------------------------------------------
+
+    /**
+     * Returns the sound for a set of params, rendering it if it isn't cached
+     * The buffer stays valid after the sound is evicted
+     * @param	params		Sound to look up
+     * @param	sampleRate	Sample rate the sound is rendered at
+     */
+    Buffer get (const SfxrParams& params, float sampleRate = 44100.0f);
+
+    /** Returns true if the sound is cached, without counting a hit or miss */
+    bool contains (const SfxrParams& params, float sampleRate = 44100.0f) const;
+
+    /** Evicts every sound */
+    void clear();
+
+    /**
+     * Stable 64 bit hash of the params values and sample rate
+     * The same values give the same hash on every run and platform
+     * @param	params		Params to hash
+     * @param	sampleRate	Sample rate to hash
+     * @param	quantization	Step the values are rounded to first, 0 for none
+     */
+    static uint64_t hashParams (const SfxrParams& params, float sampleRate, float quantization = 0.0f);
+
+private:
+    struct Key
+    {
+        std::array<float, size_t (ParamId::count)> values;
+        float sampleRate;
+        uint64_t seed;
+        uint64_t hash;
+
+        bool operator== (const Key& other) const
+        {
+            return hash == other.hash && values == other.values && sampleRate == other.sampleRate && seed == other.seed;
+        }
+    };
+
+    struct KeyHash
+    {
+        size_t operator() (const Key& key) const { return size_t (key.hash); }
+    };
+
+    struct Entry
+    {
+        Key key;
+        Buffer buffer;
+    };
+
+    static Key makeKey (const SfxrParams& params, float sampleRate, float quantization, uint64_t seed);
+    static size_t getBytes (const Buffer& buffer);
+
+    /** Evicts the least recently used sounds until the cache is under budget, lock must be held */
+    void evict();
+
+    mutable std::mutex _lock;
+    std::list<Entry> _entries;                // Most recently used first
+    std::unordered_map<Key, std::list<Entry>::iterator, KeyHash> _index;
+
+    size_t _byteBudget;
+    float _quantization = 0.0f;
+    uint64_t _seed = 0;
+    Stats _stats;
+};
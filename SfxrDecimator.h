@@ -0,0 +1,98 @@
+/**
+ * SfxrDecimator
+ *
+ * Copyright 2010 Thomas Vian
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * 	http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * @author Thomas Vian
+ */
+#pragma once
+
+#include <algorithm>
+#include <array>
+
+/**
+ * Brings oversampled sub-samples down to one sample with a cascade of half-band filters
+ *
+ * Each stage halves the rate with an 11 tap half-band FIR, so a factor of 8
+ * runs 3 stages and a factor of 1 passes the sample straight through. Every
+ * other tap of a half-band filter is zero, leaving 4 multiplies per stage.
+ * The cascade delays the sound by about 4 samples at a factor of 8.
+ */
+class SfxrDecimator
+{
+public:
+    static constexpr int maxFactor = 8;
+
+    /** Sets the number of sub-samples per sample, 1, 2, 4 or 8, and clears the filters */
+    void setFactor (int factor)
+    {
+        _numStages = 0;
+        while ((1 << _numStages) < factor && (1 << _numStages) < maxFactor)
+            _numStages++;
+
+        reset();
+    }
+
+    int getFactor() const
+    {
+        return 1 << _numStages;
+    }
+
+    void reset()
+    {
+        for (auto& stage : _stages)
+            stage.fill (0.0f);
+    }
+
+    /**
+     * Filters and decimates one sample's worth of sub-samples
+     * @param	subSamples		getFactor() sub-samples, overwritten by the intermediate stages
+     * @return					The sample, with the same gain as the average of the sub-samples
+     */
+    float process (float* subSamples)
+    {
+        int count = 1 << _numStages;
+
+        for (int s = 0; s < _numStages; s++)
+        {
+            count /= 2;
+            for (int i = 0; i < count; i++)
+                subSamples[i] = push (_stages[size_t (s)], subSamples[2 * i], subSamples[2 * i + 1]);
+        }
+
+        return subSamples[0];
+    }
+
+private:
+    static constexpr int numTaps = 11;
+
+    using History = std::array<float, numTaps>;
+
+    /** Adds two samples to a stage and returns its output, taps are [3 0 -25 0 150 256 150 0 -25 0 3] / 512 */
+    static float push (History& h, float a, float b)
+    {
+        std::copy (h.begin() + 2, h.end(), h.begin());
+        h[numTaps - 2] = a;
+        h[numTaps - 1] = b;
+
+        return 0.5f * h[5]
+            + (150.0f / 512.0f) * (h[4] + h[6])
+            - (25.0f / 512.0f) * (h[2] + h[8])
+            + (3.0f / 512.0f) * (h[0] + h[10]);
+    }
+
+    int _numStages = 3;
+    std::array<History, 3> _stages {};
+};
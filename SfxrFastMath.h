@@ -0,0 +1,167 @@
+/**
+ * SfxrFastMath
+ *
+ * Copyright 2010 Thomas Vian
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * 	http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * @author Thomas Vian
+ */
+#pragma once
+
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+
+/**
+ * Polynomial approximations of the libm functions in the render loop, used
+ * by the fast math kernels (see SfxrSynth::setFastMath)
+ *
+ * Each function documents its worst error over the range the synth calls it
+ * with. bfxr-verify checks the bounds, and the sounds rendered with them,
+ * against the reference.
+ */
+namespace SfxrFastMath
+{
+    /** Worst absolute error of sin, for |x| below 8192 */
+    static constexpr float sinMaxError = 1.0e-6f;
+
+    /** Worst relative error of tan, for x from 0 to pi, about that of std::tan in floats */
+    static constexpr float tanMaxRelativeError = 1.0e-6f;
+
+    /**
+     * Worst relative error of pow, for x from the smallest normal float to 4 and y from 0 to 1
+     * Mostly the rounding of y * log2 (x) when x is tiny, it's nearer 1e-6 for x above 1e-6
+     */
+    static constexpr float powMaxRelativeError = 1.0e-5f;
+
+    /** Rounds to the nearest whole number, without the libm call std::nearbyint is without SSE4.1 */
+    inline int roundToInt (float x)
+    {
+        return int (x + (x < 0.0f ? -0.5f : 0.5f));
+    }
+
+    /**
+     * Splits x into a multiple of pi / 2 and a remainder within pi / 4 of zero
+     * pi / 2 is subtracted in three parts, the first two short enough that
+     * their multiples are exact, so the remainder keeps its precision
+     * @return				The multiple, only its low two bits matter to the callers
+     */
+    inline int reduceHalfPi (float x, float& remainder)
+    {
+        const int multiple = roundToInt (x * 0.636619772f);
+        const float k = float (multiple);
+
+        remainder = ((x - k * 1.5703125f) - k * 4.837512969970703125e-4f) - k * 7.54978995489188216e-8f;
+        return multiple;
+    }
+
+    /** sin of a remainder from reduceHalfPi */
+    inline float sinReduced (float r)
+    {
+        const float z = r * r;
+        return ((-1.9515295891e-4f * z + 8.3321608736e-3f) * z - 1.6666654611e-1f) * z * r + r;
+    }
+
+    /** cos of a remainder from reduceHalfPi */
+    inline float cosReduced (float r)
+    {
+        const float z = r * r;
+        return ((2.443315711809948e-5f * z - 1.388731625493765e-3f) * z + 4.166664568298827e-2f) * z * z - 0.5f * z + 1.0f;
+    }
+
+    /** sin (x), for the vibrato */
+    inline float sin (float x)
+    {
+        float r;
+        switch (reduceHalfPi (x, r) & 3)
+        {
+            case 0:  return sinReduced (r);
+            case 1:  return cosReduced (r);
+            case 2:  return -sinReduced (r);
+            default: return -cosReduced (r);
+        }
+    }
+
+    /**
+     * tan (x), for the tan wave
+     * Each period of the wave passes through the pole at pi / 2, where the
+     * remainder is tiny and the result large and of the same sign as std::tan
+     */
+    inline float tan (float x)
+    {
+        float r;
+        const int k = reduceHalfPi (x, r);
+
+        const float z = r * r;
+        const float t = (((((9.38540185543e-3f * z + 3.11992232697e-3f) * z + 2.44301354525e-2f) * z
+                            + 5.34112807005e-2f) * z + 1.33387994085e-1f) * z + 3.33331568548e-1f) * z * r + r;
+
+        return (k & 1) != 0 ? -1.0f / t : t;
+    }
+
+    /** log2 (x) for positive, normal x */
+    inline float log2 (float x)
+    {
+        uint32_t bits;
+        std::memcpy (&bits, &x, sizeof (bits));
+
+        // Mantissa brought into [sqrt (0.5), sqrt (2)), so u stays small either side of 1
+        int exponent = int ((bits >> 23) & 0xff) - 127;
+        bits = (bits & 0x007fffffu) | 0x3f800000u;
+        if (bits > 0x3fb504f3u)
+        {
+            bits -= 0x00800000u;
+            exponent++;
+        }
+
+        float m;
+        std::memcpy (&m, &bits, sizeof (m));
+
+        const float u = m - 1.0f;
+        const float p = (((((0.168186591f * u - 0.267963871f) * u + 0.296119557f) * u - 0.359524455f) * u
+                          + 0.480613125f) * u - 0.721360179f) * u + 1.442696523f;
+
+        return float (exponent) + u * p;
+    }
+
+    /** 2 ^ x, for x from -126 to 127 */
+    inline float exp2 (float x)
+    {
+        const int whole = roundToInt (x);
+        const float f = x - float (whole);
+
+        const float p = ((((1.33908634e-3f * f + 9.67603192e-3f) * f + 5.55035711e-2f) * f + 2.40221075e-1f) * f
+                         + 6.93147188e-1f) * f + 1.000000075f;
+
+        const uint32_t bits = uint32_t (whole + 127) << 23;
+        float scale;
+        std::memcpy (&scale, &bits, sizeof (scale));
+
+        return p * scale;
+    }
+
+    /** x ^ y for x >= 0, for the compressor */
+    inline float pow (float x, float y)
+    {
+        if (x < std::numeric_limits<float>::min())
+            return 0.0f;
+
+        float e = y * log2 (x);
+        if (e < -126.0f)
+            return 0.0f;
+
+        return exp2 (e);
+    }
+}
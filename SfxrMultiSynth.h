@@ -0,0 +1,848 @@
+/**
+ * SfxrMultiSynth
+ *
+ * Copyright 2010 Thomas Vian
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * @author Thomas Vian
+ */
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <type_traits>
+
+#include "SfxrNoise.h"
+#include "SfxrOscillator.h"
+#include "SfxrPatch.h"
+#include "SfxrSynth.h"
+
+/**
+ * Renders several sounds at once, one per SIMD lane
+ *
+ * The synth state is stored as structure-of-arrays, one element per voice,
+ * and each stage steps SfxrOscillator vectors across the voices, so 4, 8 or
+ * 16 voices advance per pass, including the filter chain that can't be
+ * vectorised within a single voice. Lanes that play different wave types or
+ * are in different envelope stages are handled by evaluating each wave type
+ * in use and selecting per lane. Stages that no playing lane needs are
+ * skipped, and noise, tan, whistle, vibrato, pitch change, repeat, flanger
+ * and compression fall back to a per lane loop over the lanes that use them.
+ *
+ * Each lane renders the same samples as an SfxrSynth started at the same
+ * time, however either is split into calls, at the default oversampling
+ * and without harmonic wavetables.
+ * Nothing allocates, so it can be used from an audio callback.
+ */
+template <int Lanes>
+class SfxrMultiSynth
+{
+public:
+    static_assert (Lanes == 4 || Lanes == 8 || Lanes == 16, "Lanes must be 4, 8 or 16");
+
+    static constexpr int numLanes = Lanes;
+
+    /** Every lane starts out idle */
+    SfxrMultiSynth()
+    {
+        for (int l = 0; l < Lanes; l++)
+        {
+            reset (l, true);
+            _active[l] = 0;
+        }
+    }
+
+    //--------------------------------------------------------------------------
+    //
+    //  Lane Methods
+    //
+    //--------------------------------------------------------------------------
+
+    /**
+     * Starts a sound in a lane, replacing anything it was playing
+     * @param	lane		Lane to play in
+     * @param	patch		Sound to play
+     * @param	seed		Seed of the noise waves, as SfxrSynth::setSeed
+     */
+    void start (int lane, const SfxrPatch& patch, uint64_t seed)
+    {
+        _patches[lane] = patch;
+        _seeds[lane] = seed;
+        reset (lane, true);
+        _active[lane] = 1;
+        updateFeatures();
+    }
+
+    /** Stops the sound in a lane */
+    void stop (int lane)
+    {
+        _active[lane] = 0;
+        updateFeatures();
+    }
+
+    bool isActive (int lane) const
+    {
+        return _active[lane] != 0;
+    }
+
+    /** Returns a lane that isn't playing, or -1 if they all are */
+    int findFreeLane() const
+    {
+        for (int l = 0; l < Lanes; l++)
+            if (! _active[l])
+                return l;
+
+        return -1;
+    }
+
+    int getNumActive() const
+    {
+        int count = 0;
+        for (int l = 0; l < Lanes; l++)
+            count += _active[l];
+
+        return count;
+    }
+
+    //--------------------------------------------------------------------------
+    //
+    //  Render Methods
+    //
+    //--------------------------------------------------------------------------
+
+    /**
+     * Adds the next samples of each lane to its own buffer
+     * A lane that finishes stops being written to, as SfxrSynth::render
+     * @param	outputs		One buffer per lane, null to skip a lane
+     * @param	length		Number of samples
+     */
+    void render (float* const* outputs, int length)
+    {
+        ScopedFlushDenormals flushDenormals;
+
+        for (int start = 0; start < length && getNumActive() > 0; start += blockSize)
+        {
+            int count = std::min (length - start, blockSize);
+            renderBlock (count);
+
+            for (int l = 0; l < Lanes; l++)
+                if (outputs[l] != nullptr)
+                    for (int i = 0; i < _end[l]; i++)
+                        outputs[l][start + i] += _blockSample[i][l];
+        }
+    }
+
+    /**
+     * Adds the next samples of every lane to one buffer
+     * @param	buffer		Buffer to mix into
+     * @param	length		Number of samples
+     */
+    void renderMix (float* buffer, int length)
+    {
+        ScopedFlushDenormals flushDenormals;
+
+        for (int start = 0; start < length && getNumActive() > 0; start += blockSize)
+        {
+            int count = std::min (length - start, blockSize);
+            renderBlock (count);
+
+            for (int i = 0; i < count; i++)
+            {
+                float sum = 0.0f;
+                for (int l = 0; l < Lanes; l++)
+                    sum += i < _end[l] ? _blockSample[i][l] : 0.0f;
+
+                buffer[start + i] += sum;
+            }
+        }
+    }
+
+private:
+    /** The widest SfxrOscillator vector that divides the lanes */
+   #if SFXR_OSCILLATOR_AVX
+    using Vec = std::conditional_t<Lanes % SfxrOscillator::Vec8::size == 0, SfxrOscillator::Vec8, SfxrOscillator::Vec4>;
+   #else
+    using Vec = SfxrOscillator::Vec;
+   #endif
+
+    static constexpr int blockSize = 64;      // Samples per block, as SfxrSynth
+
+    //--------------------------------------------------------------------------
+    //
+    //  Reset
+    //
+    //--------------------------------------------------------------------------
+
+    /** Same as SfxrSynth::reset for one lane */
+    void reset (int l, bool totalReset)
+    {
+        const SfxrPatch& p = _patches[l];
+
+        _period[l] = p.period;
+        _maxPeriod[l] = p.maxPeriod;
+
+        _slide[l] = p.slide;
+        _deltaSlide[l] = p.deltaSlide;
+
+        _squareDuty[l] = p.squareDuty;
+        _dutySweep[l] = p.dutySweep;
+
+        _changePeriod[l] = p.changePeriod;
+        _changePeriodTime[l] = 0;
+
+        _changeAmount[l] = p.changeAmount;
+        _changeTime[l] = 0;
+        _changeReached[l] = 0;
+        _changeLimit[l] = p.changeLimit;
+
+        _changeAmount2[l] = p.changeAmount2;
+        _changeTime2[l] = 0;
+        _changeReached2[l] = 0;
+        _changeLimit2[l] = p.changeLimit2;
+
+        if (totalReset)
+        {
+            _masterVolume[l] = p.masterVolume;
+            _waveType[l] = float (std::min (p.waveType, 8u));
+            _sustainPunch[l] = p.sustainPunch;
+
+            _phase[l] = 0.0f;
+
+            _minFrequency[l] = p.minFrequency;
+            _muted[l] = 0.0f;
+            _overtones[l] = float (p.overtones);
+            _overtoneFalloff[l] = p.overtoneFalloff;
+
+            _bitcrushFreq[l] = p.bitcrushFreq;
+            _bitcrushFreqSweep[l] = p.bitcrushFreqSweep;
+            _bitcrushPhase[l] = 0.0f;
+            _bitcrushLast[l] = 0.0f;
+
+            _compressionFactor[l] = p.compressionFactor;
+
+            _filters[l] = p.filters ? 1.0f : 0.0f;
+            _lpFilterPos[l] = 0.0f;
+            _lpFilterOldPos[l] = 0.0f;
+            _lpFilterDeltaPos[l] = 0.0f;
+            _lpFilterCutoff[l] = p.lpFilterCutoff;
+            _lpFilterDeltaCutoff[l] = p.lpFilterDeltaCutoff;
+            _lpFilterDamping[l] = p.lpFilterDamping;
+            _lpFilterOn[l] = p.lpFilterOn ? 1.0f : 0.0f;
+
+            _hpFilterPos[l] = 0.0f;
+            _hpFilterCutoff[l] = p.hpFilterCutoff;
+            _hpFilterDeltaCutoff[l] = p.hpFilterDeltaCutoff;
+
+            _vibratoPhase[l] = 0.0f;
+            _vibratoSpeed[l] = p.vibratoSpeed;
+            _vibratoAmplitude[l] = p.vibratoAmplitude;
+
+            _envelopeVolume[l] = 0.0f;
+            _envelopeStage[l] = 0.0f;
+            _envelopeTime[l] = 0.0f;
+            _envelopeLength[l] = p.envelopeLength0;
+            _envelopeLength1[l] = p.envelopeLength1;
+            _envelopeLength2[l] = p.envelopeLength2;
+            _envelopeOverLength0[l] = p.envelopeOverLength0;
+            _envelopeOverLength1[l] = p.envelopeOverLength1;
+            _envelopeOverLength2[l] = p.envelopeOverLength2;
+
+            _flanger[l] = p.flanger;
+            _flangerOffset[l] = p.flangerOffset;
+            _flangerDeltaOffset[l] = p.flangerDeltaOffset;
+            _flangerPos[l] = 0;
+            std::fill (_flangerBuffer[l], _flangerBuffer[l] + 1024, 0.0f);
+
+            _noiseSeed[l] = SfxrNoise::foldSeed (_seeds[l]);
+            _noisePeriod[l] = 0;
+            fillNoise (l);
+
+            _repeatTime[l] = 0;
+            _repeatLimit[l] = p.repeatLimit;
+        }
+    }
+
+    void fillNoise (int l)
+    {
+        if (_waveType[l] == 5.0f)
+            SfxrNoise::fillPink (_noiseSeed[l], _noisePeriod[l], _noiseBuffer[l]);
+        else
+            SfxrNoise::fillWhite (_noiseSeed[l], _noisePeriod[l], _noiseBuffer[l]);
+    }
+
+    /** Collects the stages and wave types the playing lanes need */
+    void updateFeatures()
+    {
+        _features = 0;
+        _waveTypes = 0;
+        _maxOvertones = 0;
+
+        for (int l = 0; l < Lanes; l++)
+        {
+            if (! _active[l])
+                continue;
+
+            _features |= SfxrSynth::getActiveFeatures (_patches[l]);
+            _waveTypes |= 1u << int (_waveType[l]);
+            _maxOvertones = std::max (_maxOvertones, int (_overtones[l]));
+        }
+    }
+
+    //--------------------------------------------------------------------------
+    //
+    //  Render Stages
+    //
+    //--------------------------------------------------------------------------
+
+    /**
+     * Renders a block of every lane into _blockSample
+     * _end is set to the number of samples each lane rendered, lanes that
+     * finish within the block are stopped
+     */
+    void renderBlock (int count)
+    {
+        for (int l = 0; l < Lanes; l++)
+            _end[l] = _active[l] ? count : 0;
+
+        for (int i = 0; i < count; i++)
+            control (i);
+
+        for (int i = 0; i < count; i++)
+            oscillator (i);
+
+        for (int i = 0; i < count; i++)
+            output (i);
+
+        bool finished = false;
+        for (int l = 0; l < Lanes; l++)
+        {
+            if (_active[l] && _end[l] < count)
+            {
+                _active[l] = 0;
+                finished = true;
+            }
+        }
+
+        if (finished)
+            updateFeatures();
+    }
+
+    /** Zeroes the denormal lanes of filter state, as SfxrSynth::flushDenormal does where ScopedFlushDenormals can't */
+    static Vec flushDenormals (Vec value)
+    {
+#if ! SFXR_HAS_MXCSR
+        return Vec::select (Vec::abs (value) < Vec::set (std::numeric_limits<float>::min()), Vec::set (0.0f), value);
+#else
+        return value;
+#endif
+    }
+
+    /** Same as SfxrSynth::synthControl for one sample of every lane */
+    void control (int i)
+    {
+        const Vec zero = Vec::set (0.0f), one = Vec::set (1.0f);
+
+        if (_features & SfxrSynth::featureRepeat)
+        {
+            for (int l = 0; l < Lanes; l++)
+            {
+                if (_repeatLimit[l] != 0 && ++_repeatTime[l] >= _repeatLimit[l])
+                {
+                    _repeatTime[l] = 0;
+                    reset (l, false);
+                }
+            }
+        }
+
+        if (_features & SfxrSynth::featurePitchChange)
+        {
+            for (int l = 0; l < Lanes; l++)
+            {
+                if (++_changePeriodTime[l] >= _changePeriod[l])
+                {
+                    _changeTime[l] = 0;
+                    _changeTime2[l] = 0;
+                    _changePeriodTime[l] = 0;
+                    if (_changeReached[l])
+                    {
+                        _period[l] /= _changeAmount[l];
+                        _changeReached[l] = 0;
+                    }
+                    if (_changeReached2[l])
+                    {
+                        _period[l] /= _changeAmount2[l];
+                        _changeReached2[l] = 0;
+                    }
+                }
+
+                if (! _changeReached[l] && ++_changeTime[l] >= _changeLimit[l])
+                {
+                    _changeReached[l] = 1;
+                    _period[l] *= _changeAmount[l];
+                }
+
+                if (! _changeReached2[l] && ++_changeTime2[l] >= _changeLimit2[l])
+                {
+                    _period[l] *= _changeAmount2[l];
+                    _changeReached2[l] = 1;
+                }
+            }
+        }
+
+        // Accelerates and applies the slide, stopping at the minimum frequency
+        for (int l = 0; l < Lanes; l += Vec::size)
+        {
+            Vec slide = Vec::load (_slide + l) + Vec::load (_deltaSlide + l);
+            Vec period = Vec::load (_period + l) * slide;
+            Vec maxPeriod = Vec::load (_maxPeriod + l);
+            Vec tooLow = period > maxPeriod;
+
+            slide.store (_slide + l);
+            Vec::select (tooLow, maxPeriod, period).store (_period + l);
+            Vec::select (tooLow & (Vec::load (_minFrequency + l) > zero), one, Vec::load (_muted + l)).store (_muted + l);
+        }
+
+        // Applies the vibrato
+        if (_features & SfxrSynth::featureVibrato)
+        {
+            for (int l = 0; l < Lanes; l++)
+            {
+                _periodTemp[l] = _period[l];
+                if (_vibratoAmplitude[l] > 0.0f)
+                {
+                    _vibratoPhase[l] += _vibratoSpeed[l];
+                    _periodTemp[l] = _period[l] * (1.0f + std::sin (_vibratoPhase[l]) * _vibratoAmplitude[l]);
+                }
+            }
+        }
+        else
+        {
+            std::copy (_period, _period + Lanes, _periodTemp);
+        }
+
+        for (int l = 0; l < Lanes; l += Vec::size)
+        {
+            Vec periodTemp = Vec::floorPositive (Vec::load (_periodTemp + l));
+            Vec::select (periodTemp < Vec::set (8.0f), Vec::set (8.0f), periodTemp).store (_blockPeriod[i] + l);
+        }
+
+        // Sweeps the square duty
+        if (_features & SfxrSynth::featureDutySweep)
+        {
+            for (int l = 0; l < Lanes; l += Vec::size)
+            {
+                Vec sweep = Vec::load (_dutySweep + l);
+                Vec duty = Vec::load (_squareDuty + l);
+                Vec swept = duty + sweep;
+                swept = Vec::select (swept < zero, zero, Vec::select (swept > Vec::set (0.5f), Vec::set (0.5f), swept));
+                Vec::select ((Vec::abs (sweep) > zero) & (Vec::load (_waveType + l) == zero), swept, duty).store (_squareDuty + l);
+            }
+        }
+        std::copy (_squareDuty, _squareDuty + Lanes, _blockSquareDuty[i]);
+
+        // Moves through the different stages of the volume envelope and sets the volume
+        for (int l = 0; l < Lanes; l += Vec::size)
+        {
+            const Vec two = Vec::set (2.0f);
+
+            Vec time = Vec::load (_envelopeTime + l) + one;
+            Vec nextStage = time > Vec::load (_envelopeLength + l);
+            Vec stage = Vec::select (nextStage, Vec::load (_envelopeStage + l) + one, Vec::load (_envelopeStage + l));
+            time = Vec::select (nextStage, zero, time);
+
+            Vec length = Vec::select (nextStage & (stage == one), Vec::load (_envelopeLength1 + l), Vec::load (_envelopeLength + l));
+            Vec::select (nextStage & (stage == two), Vec::load (_envelopeLength2 + l), length).store (_envelopeLength + l);
+
+            Vec attack = time * Vec::load (_envelopeOverLength0 + l);
+            Vec sustain = one + (one - time * Vec::load (_envelopeOverLength1 + l)) * two * Vec::load (_sustainPunch + l);
+            Vec decay = one - time * Vec::load (_envelopeOverLength2 + l);
+
+            Vec volume = Vec::select (stage == Vec::set (3.0f), zero, Vec::load (_envelopeVolume + l));
+            volume = Vec::select (stage == two, decay, volume);
+            volume = Vec::select (stage == one, sustain, volume);
+            volume = Vec::select (stage == zero, attack, volume);
+
+            volume.store (_envelopeVolume + l);
+            volume.store (_blockEnvelopeVolume[i] + l);
+            time.store (_envelopeTime + l);
+            stage.store (_envelopeStage + l);
+        }
+
+        // Lanes that reach the end of the envelope stop after this sample
+        for (int l = 0; l < Lanes; l++)
+            if (_end[l] > i && _envelopeStage[l] >= 3.0f)
+                _end[l] = i + 1;
+
+        // Moves the flanger offset
+        if (_features & SfxrSynth::featureFlanger)
+        {
+            for (int l = 0; l < Lanes; l++)
+            {
+                _flangerOffset[l] += _flangerDeltaOffset[l];
+                int offset = int (_flangerOffset[l]);
+                _blockFlangerInt[i][l] = offset < 0 ? -offset : (offset > 1023 ? 1023 : offset);
+            }
+        }
+
+        // Moves the high-pass filter cutoff
+        if (_features & SfxrSynth::featureFilters)
+        {
+            for (int l = 0; l < Lanes; l += Vec::size)
+            {
+                Vec delta = Vec::load (_hpFilterDeltaCutoff + l);
+                Vec cutoff = Vec::load (_hpFilterCutoff + l);
+                Vec swept = cutoff * delta;
+                swept = Vec::select (swept < Vec::set (0.00001f), Vec::set (0.00001f), Vec::select (swept > Vec::set (0.1f), Vec::set (0.1f), swept));
+                Vec::select (Vec::abs (delta) > zero, swept, cutoff).store (_hpFilterCutoff + l);
+            }
+            std::copy (_hpFilterCutoff, _hpFilterCutoff + Lanes, _blockHpFilterCutoff[i]);
+        }
+
+        std::copy (_muted, _muted + Lanes, _blockMuted[i]);
+    }
+
+    /**
+     * Same as the scalar SfxrSynth::synthOscillator for one sample of every lane
+     * Phases and wave types are whole numbers well below 2^24, so they are
+     * held as floats without any loss.
+     */
+    void oscillator (int i)
+    {
+        const Vec zero = Vec::set (0.0f), one = Vec::set (1.0f), two = Vec::set (2.0f);
+        const unsigned int scalarTypes = _waveTypes & ((1u << 3) | (1u << 5) | (1u << 6) | (1u << 7));
+        const bool noise = (_waveTypes & ((1u << 3) | (1u << 5))) != 0;
+        const float* periods = _blockPeriod[i];
+
+        alignas (64) float superSample[Lanes] = {};
+        alignas (64) float sample[Lanes], overtoneStrength[Lanes], tempPhase[Lanes], value[Lanes], lastPhase[Lanes];
+
+        for (int j = 0; j < 8; j++)
+        {
+            if (noise)
+                std::copy (_phase, _phase + Lanes, lastPhase);
+
+            // Cycles through the period
+            for (int l = 0; l < Lanes; l += Vec::size)
+            {
+                Vec period = Vec::load (periods + l);
+                Vec phase = Vec::load (_phase + l) + one;
+                Vec::select (phase >= period, phase - period, phase).store (_phase + l);
+            }
+
+            // Moves the noise on to the next period
+            if (noise)
+            {
+                for (int l = 0; l < Lanes; l++)
+                {
+                    if (_phase[l] != lastPhase[l] + 1.0f && (_waveType[l] == 3.0f || _waveType[l] == 5.0f))
+                    {
+                        _noisePeriod[l]++;
+                        fillNoise (l);
+                    }
+                }
+            }
+
+            for (int l = 0; l < Lanes; l++)
+            {
+                sample[l] = 0.0f;
+                overtoneStrength[l] = 1.0f;
+            }
+
+            for (int k = 0; k <= _maxOvertones; k++)
+            {
+                for (int l = 0; l < Lanes; l += Vec::size)
+                {
+                    const Vec period = Vec::load (periods + l);
+                    const Vec type = Vec::load (_waveType + l);
+
+                    // fmod of two whole numbers below 2^24, done exactly
+                    Vec x = Vec::load (_phase + l) * Vec::set (float (k + 1));
+                    Vec tempphase = x - Vec::floorPositive (x / period) * period;
+                    tempphase = tempphase + (Vec (tempphase < zero) & period);
+                    tempphase = tempphase - (Vec (tempphase >= period) & period);
+                    tempphase.store (tempPhase + l);
+
+                    Vec pos = tempphase / period;
+                    Vec v = zero;
+
+                    if (_waveTypes & (1u << 0)) // Square wave
+                        v = Vec::select (type == zero, Vec::select (pos < Vec::load (_blockSquareDuty[i] + l), Vec::set (0.5f), Vec::set (-0.5f)), v);
+                    if (_waveTypes & (1u << 1)) // Saw wave
+                        v = Vec::select (type == one, one - pos * two, v);
+                    if (_waveTypes & (1u << 2)) // Sine wave
+                        v = Vec::select (type == two, SfxrOscillator::sine (pos), v);
+                    if (_waveTypes & (1u << 4)) // Triangle wave
+                        v = Vec::select (type == Vec::set (4.0f), Vec::abs (one - pos * two) - one, v);
+                    if (_waveTypes & (1u << 8)) // Breaker
+                        v = Vec::select (type == Vec::set (8.0f), Vec::abs (one - pos * pos * two) - one, v);
+
+                    v.store (value + l);
+                }
+
+                if (scalarTypes != 0)
+                    scalarWaves (i, tempPhase, value);
+
+                for (int l = 0; l < Lanes; l += Vec::size)
+                {
+                    Vec strength = Vec::load (overtoneStrength + l);
+                    Vec s = Vec::load (sample + l);
+
+                    Vec::select (Vec::load (_overtones + l) >= Vec::set (float (k)), s + strength * Vec::load (value + l), s).store (sample + l);
+                    (strength * (one - Vec::load (_overtoneFalloff + l))).store (overtoneStrength + l);
+                }
+            }
+
+            // Applies the low and high pass filters
+            if (_features & SfxrSynth::featureFilters)
+            {
+                for (int l = 0; l < Lanes; l += Vec::size)
+                {
+                    const Vec on = Vec::load (_filters + l) > zero;
+                    const Vec lpOn = Vec::load (_lpFilterOn + l) > zero;
+                    const Vec s = Vec::load (sample + l);
+
+                    Vec oldPos = Vec::load (_lpFilterPos + l);
+                    Vec cutoff = Vec::load (_lpFilterCutoff + l) * Vec::load (_lpFilterDeltaCutoff + l);
+                    cutoff = Vec::select (cutoff < zero, zero, Vec::select (cutoff > Vec::set (0.1f), Vec::set (0.1f), cutoff));
+
+                    Vec deltaPos = flushDenormals (Vec::select (lpOn, (Vec::load (_lpFilterDeltaPos + l) + (s - oldPos) * cutoff) * Vec::load (_lpFilterDamping + l), zero));
+                    Vec lpPos = flushDenormals (Vec::select (lpOn, oldPos, s) + deltaPos);
+                    Vec hpPos = flushDenormals ((Vec::load (_hpFilterPos + l) + (lpPos - oldPos)) * (one - Vec::load (_blockHpFilterCutoff[i] + l)));
+
+                    Vec::select (on, oldPos, Vec::load (_lpFilterOldPos + l)).store (_lpFilterOldPos + l);
+                    Vec::select (on, cutoff, Vec::load (_lpFilterCutoff + l)).store (_lpFilterCutoff + l);
+                    Vec::select (on, deltaPos, Vec::load (_lpFilterDeltaPos + l)).store (_lpFilterDeltaPos + l);
+                    Vec::select (on, lpPos, oldPos).store (_lpFilterPos + l);
+                    Vec::select (on, hpPos, Vec::load (_hpFilterPos + l)).store (_hpFilterPos + l);
+                    Vec::select (on, hpPos, s).store (sample + l);
+                }
+            }
+
+            // Applies the flanger effect
+            if (_features & SfxrSynth::featureFlanger)
+            {
+                for (int l = 0; l < Lanes; l++)
+                {
+                    if (! _flanger[l])
+                        continue;
+
+                    _flangerBuffer[l][_flangerPos[l] & 1023] = sample[l];
+                    sample[l] += _flangerBuffer[l][(_flangerPos[l] - _blockFlangerInt[i][l] + 1024) & 1023];
+                    _flangerPos[l] = (_flangerPos[l] + 1) & 1023;
+                }
+            }
+
+            for (int l = 0; l < Lanes; l += Vec::size)
+                (Vec::load (superSample + l) + Vec::load (sample + l)).store (superSample + l);
+        }
+
+        for (int l = 0; l < Lanes; l += Vec::size)
+        {
+            // Clipping if too loud
+            Vec s = Vec::load (superSample + l);
+            s = Vec::select (s > Vec::set (8.0f), Vec::set (8.0f), Vec::select (s < Vec::set (-8.0f), Vec::set (-8.0f), s));
+
+            // Averages out the super samples and applies volumes
+            (Vec::load (_masterVolume + l) * Vec::load (_blockEnvelopeVolume[i] + l) * s * Vec::set (0.125f)).store (_blockSample[i] + l);
+        }
+    }
+
+    /** Evaluates the noise, tan and whistle waves, which have no vector path, for the lanes playing them */
+    void scalarWaves (int i, const float* tempPhase, float* value)
+    {
+        const float* periods = _blockPeriod[i];
+
+        for (int l = 0; l < Lanes; l++)
+        {
+            switch (int (_waveType[l]))
+            {
+                case 3: // Noise
+                case 5: // Pink noise
+                    value[l] = _noiseBuffer[l][(unsigned int)(tempPhase[l] * 32 / float (int (periods[l]))) % 32];
+                    break;
+
+                case 6: // Tan
+                    value[l] = std::tan (float (pi) * tempPhase[l] / periods[l]);
+                    break;
+
+                case 7: // Whistle, a sine with an overtone at 20x frequency and 0.25 amplitude
+                {
+                    float whistle = std::fmod ((tempPhase[l] * 20), periods[l]) / periods[l];
+                    value[l] = 0.75f * SfxrOscillator::sine (tempPhase[l] / periods[l]) + 0.25f * SfxrOscillator::sine (whistle);
+                    break;
+                }
+
+                default:
+                    break;
+            }
+        }
+    }
+
+    /** Same as SfxrSynth::synthOutput for one sample of every lane */
+    void output (int i)
+    {
+        const Vec zero = Vec::set (0.0f), one = Vec::set (1.0f);
+        float* samples = _blockSample[i];
+
+        // Bit crush, with no crush or sweep the frequency stays at 1, leaving just the sample and hold
+        for (int l = 0; l < Lanes; l += Vec::size)
+        {
+            Vec phase = Vec::load (_bitcrushPhase + l) + Vec::load (_bitcrushFreq + l);
+            Vec hold = phase > one;
+            Vec::select (hold, zero, phase).store (_bitcrushPhase + l);
+
+            Vec last = Vec::select (hold, Vec::load (samples + l), Vec::load (_bitcrushLast + l));
+            last.store (_bitcrushLast + l);
+            last.store (samples + l);
+
+            Vec freq = Vec::load (_bitcrushFreq + l) + Vec::load (_bitcrushFreqSweep + l);
+            freq = Vec::select (one < freq, one, freq);
+            Vec::select (freq < zero, zero, freq).store (_bitcrushFreq + l);
+        }
+
+        // Compressor
+        if (_features & SfxrSynth::featureCompression)
+        {
+            for (int l = 0; l < Lanes; l++)
+            {
+                if (_compressionFactor[l] == 1.0f)
+                    continue;
+
+                if (samples[l] > 0)
+                    samples[l] = std::pow (samples[l], _compressionFactor[l]);
+                else
+                    samples[l] = -std::pow (-samples[l], _compressionFactor[l]);
+            }
+        }
+
+        for (int l = 0; l < Lanes; l += Vec::size)
+            Vec::select (Vec::load (_blockMuted[i] + l) > zero, zero, Vec::load (samples + l)).store (samples + l);
+    }
+
+    //--------------------------------------------------------------------------
+    //
+    //  Lane Variables
+    //
+    //  Each array holds one SfxrSynth variable for every lane, see SfxrSynth
+    //  for what they mean. Flags, stages and counts that are used in vector
+    //  code are floats, holding 0 or 1 and whole numbers.
+    //
+    //--------------------------------------------------------------------------
+
+    SfxrPatch _patches[Lanes];                // Patch each lane was started with, for the repeat reset
+    uint64_t _seeds[Lanes] = {};
+    int _active[Lanes];                       // If the lane is playing
+    int _end[Lanes];                          // Samples each lane rendered in the current block
+
+    unsigned int _features = 0;               // Stages needed by any playing lane
+    unsigned int _waveTypes = 0;              // Bit per wave type played by any lane
+    int _maxOvertones = 0;                    // Most overtones of any playing lane
+
+    alignas (64) float _masterVolume[Lanes];
+    alignas (64) float _waveType[Lanes];
+
+    alignas (64) float _envelopeVolume[Lanes];
+    alignas (64) float _envelopeStage[Lanes];
+    alignas (64) float _envelopeTime[Lanes];
+    alignas (64) float _envelopeLength[Lanes];
+    alignas (64) float _envelopeLength1[Lanes];
+    alignas (64) float _envelopeLength2[Lanes];
+    alignas (64) float _envelopeOverLength0[Lanes];
+    alignas (64) float _envelopeOverLength1[Lanes];
+    alignas (64) float _envelopeOverLength2[Lanes];
+    alignas (64) float _sustainPunch[Lanes];
+
+    alignas (64) float _phase[Lanes];
+    alignas (64) float _period[Lanes];
+    alignas (64) float _periodTemp[Lanes];
+    alignas (64) float _maxPeriod[Lanes];
+
+    alignas (64) float _slide[Lanes];
+    alignas (64) float _deltaSlide[Lanes];
+    alignas (64) float _minFrequency[Lanes];
+    alignas (64) float _muted[Lanes];
+
+    alignas (64) float _overtones[Lanes];
+    alignas (64) float _overtoneFalloff[Lanes];
+
+    alignas (64) float _vibratoPhase[Lanes];
+    alignas (64) float _vibratoSpeed[Lanes];
+    alignas (64) float _vibratoAmplitude[Lanes];
+
+    alignas (64) float _changePeriod[Lanes];
+    alignas (64) int _changePeriodTime[Lanes];
+    alignas (64) float _changeAmount[Lanes];
+    alignas (64) int _changeTime[Lanes];
+    alignas (64) int _changeLimit[Lanes];
+    alignas (64) int _changeReached[Lanes];
+    alignas (64) float _changeAmount2[Lanes];
+    alignas (64) int _changeTime2[Lanes];
+    alignas (64) int _changeLimit2[Lanes];
+    alignas (64) int _changeReached2[Lanes];
+
+    alignas (64) float _squareDuty[Lanes];
+    alignas (64) float _dutySweep[Lanes];
+
+    alignas (64) int _repeatTime[Lanes];
+    alignas (64) int _repeatLimit[Lanes];
+
+    alignas (64) int _flanger[Lanes];
+    alignas (64) float _flangerOffset[Lanes];
+    alignas (64) float _flangerDeltaOffset[Lanes];
+    alignas (64) int _flangerPos[Lanes];
+    alignas (64) float _flangerBuffer[Lanes][1024];
+
+    alignas (64) float _filters[Lanes];
+    alignas (64) float _lpFilterPos[Lanes];
+    alignas (64) float _lpFilterOldPos[Lanes];
+    alignas (64) float _lpFilterDeltaPos[Lanes];
+    alignas (64) float _lpFilterCutoff[Lanes];
+    alignas (64) float _lpFilterDeltaCutoff[Lanes];
+    alignas (64) float _lpFilterDamping[Lanes];
+    alignas (64) float _lpFilterOn[Lanes];
+
+    alignas (64) float _hpFilterPos[Lanes];
+    alignas (64) float _hpFilterCutoff[Lanes];
+    alignas (64) float _hpFilterDeltaCutoff[Lanes];
+
+    alignas (64) uint32_t _noiseSeed[Lanes];
+    alignas (64) uint32_t _noisePeriod[Lanes];
+    alignas (64) float _noiseBuffer[Lanes][SfxrNoise::slotsPerPeriod];
+
+    alignas (64) float _bitcrushFreq[Lanes];
+    alignas (64) float _bitcrushFreqSweep[Lanes];
+    alignas (64) float _bitcrushPhase[Lanes];
+    alignas (64) float _bitcrushLast[Lanes];
+    alignas (64) float _compressionFactor[Lanes];
+
+    //--------------------------------------------------------------------------
+    //
+    //  Block Variables
+    //
+    //--------------------------------------------------------------------------
+
+    alignas (64) float _blockPeriod[blockSize][Lanes];
+    alignas (64) float _blockSquareDuty[blockSize][Lanes];
+    alignas (64) float _blockEnvelopeVolume[blockSize][Lanes];
+    alignas (64) float _blockHpFilterCutoff[blockSize][Lanes];
+    alignas (64) float _blockMuted[blockSize][Lanes];
+    alignas (64) int _blockFlangerInt[blockSize][Lanes];
+    alignas (64) float _blockSample[blockSize][Lanes];
+};
+
+typedef SfxrMultiSynth<4> SfxrMultiSynth4;
+typedef SfxrMultiSynth<8> SfxrMultiSynth8;
+typedef SfxrMultiSynth<16> SfxrMultiSynth16;
@@ -0,0 +1,125 @@
+/**
+ * SfxrNoise
+ *
+ * Copyright 2010 Thomas Vian
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * 	http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * @author Thomas Vian
+ */
+#pragma once
+
+#include <cstdint>
+
+/**
+ * Counter based noise for the noise wave types
+ *
+ * Every value is a hash of the seed, the period of the wave it falls in and
+ * its slot within that period, so nothing is stored, nothing has to be
+ * carried from one period to the next and the noise of any period can be
+ * computed directly. All of it is plain integer maths, so the fill loops vectorise.
+ */
+namespace SfxrNoise
+{
+    /** Number of noise values per period of the wave */
+    constexpr uint32_t slotsPerPeriod = 32;
+
+    /** Mixes the bits of a 32 bit value (lowbias32) */
+    inline uint32_t mix (uint32_t x)
+    {
+        x ^= x >> 16;
+        x *= 0x7feb352du;
+        x ^= x >> 15;
+        x *= 0x846ca68bu;
+        x ^= x >> 16;
+        return x;
+    }
+
+    /** Hashes a seed and two counters */
+    inline uint32_t hash (uint32_t seed, uint32_t a, uint32_t b)
+    {
+        return mix (mix (seed ^ (a * 0x9e3779b1u)) ^ (b * 0x85ebca77u));
+    }
+
+    /** Folds a 64 bit seed down to the 32 bits the hash takes */
+    inline uint32_t foldSeed (uint64_t seed)
+    {
+        return uint32_t (seed) ^ uint32_t (seed >> 32);
+    }
+
+    /**
+     * White noise from -1 up to but not including 1
+     * @param	seed		Noise seed
+     * @param	period		Index of the period of the wave
+     * @param	slot		Slot within the period, 0 to slotsPerPeriod - 1
+     */
+    inline float white (uint32_t seed, uint32_t period, uint32_t slot)
+    {
+        return float (hash (seed, period, slot) >> 8) * (2.0f / 16777216.0f) - 1.0f;
+    }
+
+    /**
+     * Voss-McCartney pink noise from -1 to 0.875, the same distribution as the old stateful PinkNumber generator
+     * Five rows of white noise are summed, row i changes every 2^i values, so
+     * its current value is just the hash of index >> i.
+     * @param	seed		Noise seed
+     * @param	index		Index of the value, period * slotsPerPeriod + slot
+     */
+    inline float pink (uint32_t seed, uint32_t index)
+    {
+        uint32_t sum = 0;
+        for (uint32_t row = 0; row < 5; row++)
+            sum += ((hash (seed, index >> row, row + slotsPerPeriod) >> 8) * 25) >> 24;
+
+        return float (sum) / 64.0f - 1.0f;
+    }
+
+    /**
+     * Fills a period's worth of white noise, the same values white() returns
+     * @param	seed		Noise seed
+     * @param	period		Index of the period of the wave
+     * @param	out			slotsPerPeriod values
+     */
+    inline void fillWhite (uint32_t seed, uint32_t period, float* out)
+    {
+        for (uint32_t slot = 0; slot < slotsPerPeriod; slot++)
+            out[slot] = white (seed, period, slot);
+    }
+
+    /**
+     * Fills a period's worth of pink noise, the same values pink() returns
+     * Each row is only hashed where it changes, 62 hashes instead of 160.
+     * @param	seed		Noise seed
+     * @param	period		Index of the period of the wave
+     * @param	out			slotsPerPeriod values
+     */
+    inline void fillPink (uint32_t seed, uint32_t period, float* out)
+    {
+        uint32_t sums[slotsPerPeriod] = {};
+        uint32_t first = period * slotsPerPeriod;
+
+        for (uint32_t row = 0; row < 5; row++)
+        {
+            uint32_t step = 1u << row;
+            for (uint32_t slot = 0; slot < slotsPerPeriod; slot += step)
+            {
+                uint32_t value = ((hash (seed, (first + slot) >> row, row + slotsPerPeriod) >> 8) * 25) >> 24;
+                for (uint32_t n = 0; n < step; n++)
+                    sums[slot + n] += value;
+            }
+        }
+
+        for (uint32_t slot = 0; slot < slotsPerPeriod; slot++)
+            out[slot] = float (sums[slot]) / 64.0f - 1.0f;
+    }
+}
@@ -0,0 +1,291 @@
+/**
+ * SfxrOscillator
+ *
+ * Copyright 2010 Thomas Vian
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * 	http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * @author Thomas Vian
+ */
+#pragma once
+
+#include <cmath>
+
+#if defined (__AVX__)
+ #include <immintrin.h>
+ #define SFXR_OSCILLATOR_AVX 1
+#endif
+#if defined (__SSE2__) || defined (_M_X64) || (defined (_M_IX86_FP) && _M_IX86_FP >= 2)
+ #include <emmintrin.h>
+ #define SFXR_OSCILLATOR_SSE2 1
+#endif
+
+/**
+ * Evaluates the 8 sub-samples of one output sample in a single pass
+ *
+ * The phases are stepped by the caller, since the wrap has to match the
+ * scalar loop exactly, after that every sub-sample and overtone is
+ * independent. The maths is the same as the scalar oscillator, operation for
+ * operation, so the results are identical.
+ */
+namespace SfxrOscillator
+{
+    /** Returns true if the wave type has a vector path (square, saw, sine, triangle and breaker) */
+    constexpr bool isVectorised (unsigned int waveType)
+    {
+        return waveType == 0 || waveType == 1 || waveType == 2 || waveType == 4 || waveType == 8;
+    }
+
+   #if SFXR_OSCILLATOR_AVX
+    struct Vec8
+    {
+        static constexpr int size = 8;
+        __m256 v;
+
+        static Vec8 set (float x)                       { return { _mm256_set1_ps (x) }; }
+        static Vec8 load (const float* p)               { return { _mm256_loadu_ps (p) }; }
+        void store (float* p) const                     { _mm256_storeu_ps (p, v); }
+
+        static Vec8 fromInts (const int* p)             { return { _mm256_cvtepi32_ps (_mm256_loadu_si256 ((const __m256i*) p)) }; }
+
+        friend Vec8 operator+ (Vec8 a, Vec8 b)          { return { _mm256_add_ps (a.v, b.v) }; }
+        friend Vec8 operator- (Vec8 a, Vec8 b)          { return { _mm256_sub_ps (a.v, b.v) }; }
+        friend Vec8 operator* (Vec8 a, Vec8 b)          { return { _mm256_mul_ps (a.v, b.v) }; }
+        friend Vec8 operator/ (Vec8 a, Vec8 b)          { return { _mm256_div_ps (a.v, b.v) }; }
+
+        friend Vec8 operator< (Vec8 a, Vec8 b)          { return { _mm256_cmp_ps (a.v, b.v, _CMP_LT_OQ) }; }
+        friend Vec8 operator> (Vec8 a, Vec8 b)          { return { _mm256_cmp_ps (a.v, b.v, _CMP_GT_OQ) }; }
+        friend Vec8 operator>= (Vec8 a, Vec8 b)         { return { _mm256_cmp_ps (a.v, b.v, _CMP_GE_OQ) }; }
+        friend Vec8 operator== (Vec8 a, Vec8 b)         { return { _mm256_cmp_ps (a.v, b.v, _CMP_EQ_OQ) }; }
+        friend Vec8 operator& (Vec8 a, Vec8 b)          { return { _mm256_and_ps (a.v, b.v) }; }
+
+        static Vec8 select (Vec8 mask, Vec8 a, Vec8 b)  { return { _mm256_blendv_ps (b.v, a.v, mask.v) }; }
+        static Vec8 abs (Vec8 a)                        { return { _mm256_andnot_ps (_mm256_set1_ps (-0.0f), a.v) }; }
+        static Vec8 floorPositive (Vec8 a)              { return { _mm256_round_ps (a.v, _MM_FROUND_TO_NEG_INF | _MM_FROUND_NO_EXC) }; }
+    };
+   #endif
+
+   #if SFXR_OSCILLATOR_SSE2
+    struct Vec4
+    {
+        static constexpr int size = 4;
+        __m128 v;
+
+        static Vec4 set (float x)                       { return { _mm_set1_ps (x) }; }
+        static Vec4 load (const float* p)               { return { _mm_loadu_ps (p) }; }
+        void store (float* p) const                     { _mm_storeu_ps (p, v); }
+
+        static Vec4 fromInts (const int* p)             { return { _mm_cvtepi32_ps (_mm_loadu_si128 ((const __m128i*) p)) }; }
+
+        friend Vec4 operator+ (Vec4 a, Vec4 b)          { return { _mm_add_ps (a.v, b.v) }; }
+        friend Vec4 operator- (Vec4 a, Vec4 b)          { return { _mm_sub_ps (a.v, b.v) }; }
+        friend Vec4 operator* (Vec4 a, Vec4 b)          { return { _mm_mul_ps (a.v, b.v) }; }
+        friend Vec4 operator/ (Vec4 a, Vec4 b)          { return { _mm_div_ps (a.v, b.v) }; }
+
+        friend Vec4 operator< (Vec4 a, Vec4 b)          { return { _mm_cmplt_ps (a.v, b.v) }; }
+        friend Vec4 operator> (Vec4 a, Vec4 b)          { return { _mm_cmpgt_ps (a.v, b.v) }; }
+        friend Vec4 operator>= (Vec4 a, Vec4 b)         { return { _mm_cmpge_ps (a.v, b.v) }; }
+        friend Vec4 operator== (Vec4 a, Vec4 b)         { return { _mm_cmpeq_ps (a.v, b.v) }; }
+        friend Vec4 operator& (Vec4 a, Vec4 b)          { return { _mm_and_ps (a.v, b.v) }; }
+
+        static Vec4 select (Vec4 mask, Vec4 a, Vec4 b)  { return { _mm_or_ps (_mm_and_ps (mask.v, a.v), _mm_andnot_ps (mask.v, b.v)) }; }
+        static Vec4 abs (Vec4 a)                        { return { _mm_andnot_ps (_mm_set1_ps (-0.0f), a.v) }; }
+
+        // Only valid for values below 2^31, which the phase always is
+        static Vec4 floorPositive (Vec4 a)              { return { _mm_cvtepi32_ps (_mm_cvttps_epi32 (a.v)) }; }
+    };
+   #endif
+
+    // Scalar fallback, one lane
+    struct Vec1
+    {
+        static constexpr int size = 1;
+        float v;
+
+        static Vec1 set (float x)                       { return { x }; }
+        static Vec1 load (const float* p)               { return { *p }; }
+        void store (float* p) const                     { *p = v; }
+
+        static Vec1 fromInts (const int* p)             { return { float (*p) }; }
+
+        friend Vec1 operator+ (Vec1 a, Vec1 b)          { return { a.v + b.v }; }
+        friend Vec1 operator- (Vec1 a, Vec1 b)          { return { a.v - b.v }; }
+        friend Vec1 operator* (Vec1 a, Vec1 b)          { return { a.v * b.v }; }
+        friend Vec1 operator/ (Vec1 a, Vec1 b)          { return { a.v / b.v }; }
+
+        friend Vec1 operator< (Vec1 a, Vec1 b)          { return { a.v < b.v ? 1.0f : 0.0f }; }
+        friend Vec1 operator> (Vec1 a, Vec1 b)          { return { a.v > b.v ? 1.0f : 0.0f }; }
+        friend Vec1 operator>= (Vec1 a, Vec1 b)         { return { a.v >= b.v ? 1.0f : 0.0f }; }
+        friend Vec1 operator== (Vec1 a, Vec1 b)         { return { a.v == b.v ? 1.0f : 0.0f }; }
+        friend Vec1 operator& (Vec1 a, Vec1 b)          { return { a.v != 0.0f ? b.v : 0.0f }; }
+
+        static Vec1 select (Vec1 mask, Vec1 a, Vec1 b)  { return { mask.v != 0.0f ? a.v : b.v }; }
+        static Vec1 abs (Vec1 a)                        { return { std::abs (a.v) }; }
+        static Vec1 floorPositive (Vec1 a)              { return { std::floor (a.v) }; }
+    };
+
+    /** The widest vector the target has */
+   #if SFXR_OSCILLATOR_AVX
+    using Vec = Vec8;
+   #elif SFXR_OSCILLATOR_SSE2
+    using Vec = Vec4;
+   #else
+    using Vec = Vec1;
+   #endif
+
+    /**
+     * Fast sin approximation, the same as the scalar oscillator
+     * @param	pos		Phase from 0-1
+     */
+    template <typename V>
+    inline V sine (V pos)
+    {
+        const V half = V::set (0.5f), one = V::set (1.0f), zero = V::set (0.0f);
+        const V twoPi = V::set (6.28318531f), a = V::set (1.27323954f), b = V::set (0.405284735f), c = V::set (0.225f);
+
+        pos = V::select (pos > half, (pos - one) * twoPi, pos * twoPi);
+        V tempsample = V::select (pos < zero, a * pos + b * pos * pos, a * pos - b * pos * pos);
+        return V::select (tempsample < zero,
+                            c * (tempsample * (zero - tempsample) - tempsample) + tempsample,
+                            c * (tempsample * tempsample - tempsample) + tempsample);
+    }
+
+    /**
+     * Evaluates one oscillator for 8 sub-samples, summing the overtones
+     * @param	phases			Phase of each sub-sample, already wrapped by the caller
+     * @param	period			Period of the wave, a whole number
+     * @param	squareDuty		Duty of the square wave
+     * @param	overtones		Number of overtones
+     * @param	overtoneFalloff	The rate at which higher overtones decay
+     * @param	out				The 8 sub-samples
+     * @param	count			Number of sub-samples needed, the rest of the last vector is evaluated too
+     */
+    template <unsigned int WaveType>
+    void evaluate8 (const int* phases, float period, float squareDuty, int overtones, float overtoneFalloff, float* out, int count = 8)
+    {
+        static_assert (isVectorised (WaveType), "Wave type has no vector path");
+
+        const Vec periodV = Vec::set (period);
+        const Vec zero = Vec::set (0.0f);
+
+        for (int j = 0; j < count; j += Vec::size)
+        {
+            const Vec phase = Vec::fromInts (phases + j);
+
+            Vec sample = zero;
+            float overtonestrength = 1;
+            for (int k = 0; k <= overtones; k++)
+            {
+                // fmod of two whole numbers below 2^24, done exactly
+                Vec x = phase * Vec::set (float (k + 1));
+                Vec tempphase = x - Vec::floorPositive (x / periodV) * periodV;
+                tempphase = tempphase + (Vec (tempphase < zero) & periodV);
+                tempphase = tempphase - (Vec (tempphase >= periodV) & periodV);
+
+                Vec pos = tempphase / periodV;
+                Vec value;
+
+                if constexpr (WaveType == 0) // Square wave
+                    value = Vec::select (pos < Vec::set (squareDuty), Vec::set (0.5f), Vec::set (-0.5f));
+                else if constexpr (WaveType == 1) // Saw wave
+                    value = Vec::set (1.0f) - pos * Vec::set (2.0f);
+                else if constexpr (WaveType == 2) // Sine wave
+                    value = sine (pos);
+                else if constexpr (WaveType == 4) // Triangle Wave
+                    value = Vec::abs (Vec::set (1.0f) - pos * Vec::set (2.0f)) - Vec::set (1.0f);
+                else if constexpr (WaveType == 8) // Breaker
+                    value = Vec::abs (Vec::set (1.0f) - pos * pos * Vec::set (2.0f)) - Vec::set (1.0f);
+
+                sample = sample + Vec::set (overtonestrength) * value;
+                overtonestrength *= (1 - overtoneFalloff);
+            }
+
+            sample.store (out + j);
+        }
+    }
+
+    //--------------------------------------------------------------------------
+    //
+    //  Harmonic Wavetables
+    //
+    //--------------------------------------------------------------------------
+
+    /** Returns true if the summed overtones of the wave type can be tabulated (all but noise and tan) */
+    constexpr bool hasHarmonicTable (unsigned int waveType)
+    {
+        return isVectorised (waveType) || waveType == 7;
+    }
+
+    /** Fast sin approximation for a single phase from 0-1 */
+    inline float sine (float pos)
+    {
+        pos = pos > 0.5f ? (pos - 1.0f) * 6.28318531f : pos * 6.28318531f;
+        float tempsample = pos < 0 ? 1.27323954f * pos + 0.405284735f * pos * pos : 1.27323954f * pos - 0.405284735f * pos * pos;
+        return tempsample < 0 ? 0.225f * (tempsample * -tempsample - tempsample) + tempsample : 0.225f * (tempsample * tempsample - tempsample) + tempsample;
+    }
+
+    /**
+     * Evaluates a single value of a deterministic wave
+     * @param	waveType		Wave type, must have a harmonic table
+     * @param	pos				Phase from 0-1
+     * @param	squareDuty		Duty of the square wave
+     */
+    inline float evaluate (unsigned int waveType, float pos, float squareDuty)
+    {
+        switch (waveType)
+        {
+            case 0: return pos < squareDuty ? 0.5f : -0.5f;
+            case 1: return 1.0f - pos * 2.0f;
+            case 2: return sine (pos);
+            case 4: return std::abs (1 - pos * 2) - 1;
+            case 7:
+            {
+                float whistle = pos * 20;
+                return 0.75f * sine (pos) + 0.25f * sine (whistle - std::floor (whistle));
+            }
+            case 8: return std::abs (1 - pos * pos * 2) - 1;
+            default: return 0.0f;
+        }
+    }
+
+    /**
+     * Tabulates one period of a wave with its overtones summed
+     * The table needs size + 1 entries, the last repeats the first so lookups can interpolate without wrapping
+     * @param	table			Table to fill
+     * @param	size			Number of entries per period
+     * @param	waveType		Wave type, must have a harmonic table
+     * @param	squareDuty		Duty of the square wave
+     * @param	overtones		Number of overtones
+     * @param	overtoneFalloff	The rate at which higher overtones decay
+     */
+    inline void fillHarmonicTable (float* table, int size, unsigned int waveType, float squareDuty, int overtones, float overtoneFalloff)
+    {
+        for (int i = 0; i < size; i++)
+        {
+            double x = double (i) / size;
+
+            float sample = 0;
+            float overtonestrength = 1;
+            for (int k = 0; k <= overtones; k++)
+            {
+                double pos = x * (k + 1);
+                sample += overtonestrength * evaluate (waveType, float (pos - std::floor (pos)), squareDuty);
+                overtonestrength *= (1 - overtoneFalloff);
+            }
+
+            table[i] = sample;
+        }
+
+        table[size] = table[0];
+    }
+}
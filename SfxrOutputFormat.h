@@ -0,0 +1,147 @@
+/**
+ * SfxrOutputFormat
+ *
+ * Copyright 2010 Thomas Vian
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * 	http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * @author Thomas Vian
+ */
+#pragma once
+
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+
+#include "Util.h"
+
+/**
+ * Sample type and channel layout of a buffer written by SfxrSynth::render
+ *
+ * Samples are clipped to -1 to 1 and written over what the buffer held,
+ * integers are little endian and int24 is packed in 3 bytes. The optional
+ * dither is TPDF, one LSB either way, and is skipped for float32.
+ */
+struct SfxrOutputFormat
+{
+    enum SampleType
+    {
+        float32,
+        int16,
+        int24
+    };
+
+    enum Layout
+    {
+        mono,                                 // One sample per frame
+        stereo,                               // Two interleaved channels, both the same
+        interleaved                           // One channel of numChannels interleaved, the others are left alone
+    };
+
+    SampleType sampleType = float32;
+    Layout layout = mono;
+    int numChannels = 1;                      // Channels per frame for the interleaved layout, at least 1
+    int channel = 0;                          // Channel written for the interleaved layout, from 0 to numChannels - 1
+    bool dither = false;
+
+    /** If the fields describe a layout that can be written, nothing is written for one that can't */
+    bool isValid() const
+    {
+        if (sampleType != float32 && sampleType != int16 && sampleType != int24)
+            return false;
+
+        if (layout == interleaved)
+            return numChannels >= 1 && channel >= 0 && channel < numChannels;
+
+        return layout == mono || layout == stereo;
+    }
+
+    /** Bytes taken by one sample */
+    int getSampleSize() const
+    {
+        return sampleType == int16 ? 2 : sampleType == int24 ? 3 : 4;
+    }
+
+    /** Channels in each frame */
+    int getFrameChannels() const
+    {
+        return layout == mono ? 1 : layout == stereo ? 2 : numChannels;
+    }
+
+    /** Bytes taken by one frame */
+    int getFrameSize() const
+    {
+        return getSampleSize() * getFrameChannels();
+    }
+
+    /**
+     * Converts samples and writes them to frames, unless the format isn't valid
+     * @param	samples		Samples to write
+     * @param	count		Number of samples, one per frame
+     * @param	frames		First frame to write
+     * @param	random		Generator for the dither
+     */
+    void write (const float* samples, int count, void* frames, SfxrRandom& random) const
+    {
+        if (! isValid())
+            return;
+
+        switch (sampleType)
+        {
+            case float32:   writeSamples<float32> (samples, count, static_cast<uint8_t*> (frames), random); break;
+            case int16:     writeSamples<int16> (samples, count, static_cast<uint8_t*> (frames), random);   break;
+            case int24:     writeSamples<int24> (samples, count, static_cast<uint8_t*> (frames), random);   break;
+        }
+    }
+
+private:
+    template <SampleType Type>
+    void writeSamples (const float* samples, int count, uint8_t* frames, SfxrRandom& random) const
+    {
+        constexpr int sampleSize = Type == int16 ? 2 : Type == int24 ? 3 : 4;
+        constexpr float scale = Type == int16 ? 32767.0f : 8388607.0f;
+
+        const int channels = getFrameChannels();
+        const size_t frameSize = size_t (sampleSize * channels);
+        uint8_t* dest = frames + (layout == interleaved ? size_t (channel * sampleSize) : 0);
+
+        for (int i = 0; i < count; i++, dest += frameSize)
+        {
+            float sample = samples[i] > 1.0f ? 1.0f : samples[i] < -1.0f ? -1.0f : samples[i];
+            uint8_t bytes[4];
+
+            if constexpr (Type == float32)
+            {
+                std::memcpy (bytes, &sample, 4);
+            }
+            else
+            {
+                sample *= scale;
+
+                // Sum of two uniform values, a triangle from -1 to 1 LSB
+                if (dither)
+                    sample += float (random.uniform()) - float (random.uniform());
+
+                int32_t value = int32_t (std::lrint (sample));
+                value = value > int32_t (scale) ? int32_t (scale) : value < -int32_t (scale) - 1 ? -int32_t (scale) - 1 : value;
+
+                for (int b = 0; b < sampleSize; b++)
+                    bytes[b] = uint8_t (uint32_t (value) >> (8 * b));
+            }
+
+            std::memcpy (dest, bytes, sampleSize);
+            if (layout == stereo)
+                std::memcpy (dest + sampleSize, bytes, sampleSize);
+        }
+    }
+};
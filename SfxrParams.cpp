@@ -20,6 +20,56 @@
 
 #include "SfxrParams.h"
 
-const int SfxrParams::WAVETYPECOUNT = 9;
+// randomize used to look the powers up by uid, and its lpFilterSweep and hpFilterSweep
+// entries never matched the cutoff sweeps, so those keep a power of 1
+const Param SfxrParams::schema[SfxrParams::numParams] =
+{
+    // real name, decription, grouping,name, default, min, max, randomization power
+    {"Wave Type","Shape of the wave.", 0,"waveType",2,0,WAVETYPECOUNT-1.0f,1}, // the 6.999 thing is because this is really an int parameter...
+
+    {"Master Volume","Overall volume of the sound.", 1,"masterVolume",0.5f,0,1,1},
+    {"Attack Time","Length of the volume envelope attack.", 1,"attackTime",0,0,1,4},
+    {"Sustain Time","Length of the volume envelope sustain.", 1,"sustainTime",0.3f,0,1,2},
+    {"Punch","Tilts the sustain envelope for more 'pop'.", 1,"sustainPunch",0,0,1,2},
+    {"Decay Time","Length of the volume envelope decay (yes, I know it's called release).", 1,"decayTime",0.4f,0,1,1},
+
+    {"Compression","Pushes amplitudes together into a narrower range to make them stand out more.  Very good for sound effects, where you want them to stick out against background music.",15,"compressionAmount",0.3f,0,1,1},
+
+    {"Frequency","Base note of the sound.", 2,"startFrequency",0.3f,0,1,1},
+    {"Frequency Cutoff","If sliding, the sound will stop at this frequency, to prevent really low notes.  If unlocked, this is set to zero during randomization.", 2,"minFrequency",0.0f,0,1,1},
+
+    {"Frequency Slide","Slides the frequency up or down.", 3, "slide",0.0f,-1,1,1},
+    {"Delta Slide","Accelerates the frequency slide.  Can be used to get the frequency to change direction.", 3,"deltaSlide",0.0f,-1,1,1},
+
+    {"Vibrato Depth","Strength of the vibrato effect.", 4,"vibratoDepth",0,0,1,3},
+    {"Vibrato Speed","Speed of the vibrato effect (i.e. frequency).", 4,"vibratoSpeed",0,0,1,1},
+
+    {"Harmonics","Overlays copies of the waveform with copies and multiples of its frequency.  Good for bulking out or otherwise enriching the texture of the sounds (warning: this is the number 1 cause of bfxr slowdown!).", 13,"overtones",0,0,1,3},
+    {"Harmonics Falloff","The rate at which higher overtones should decay.", 13,"overtoneFalloff",0,0,1,0.25f},
+
+    {"Pitch Jump Repeat Speed","Larger Values means more pitch jumps, which can be useful for arpeggiation.", 5,"changeRepeat",0,0,1,1},
+    {"Pitch Jump Amount 1","Jump in pitch, either up or down.", 5,"changeAmount",0,-1,1,1},
+    {"Pitch Jump Onset 1","How quickly the note shift happens.", 5,"changeSpeed",0,0,1,1},
+    {"Pitch Jump Amount 2","Jump in pitch, either up or down.", 5,"changeAmount2",0,-1,1,1},
+    {"Pitch Jump Onset 2","How quickly the note shift happens.", 5,"changeSpeed2",0,0,1,1},
+
+    {"Square Duty","Square waveform only : Controls the ratio between the up and down states of the square wave, changing the tibre.", 8,"squareDuty",0,0,1,1},
+    {"Duty Sweep","Square waveform only : Sweeps the duty up or down.", 8,"dutySweep",0,-1,1,3},
+
+    {"Repeat Speed","Speed of the note repeating - certain variables are reset each time.", 9,"repeatSpeed",0,0,1,1},
+
+    {"Flanger Offset","Offsets a second copy of the wave by a small phase, changing the tibre.", 10,"flangerOffset",0,-1,1,3},
+    {"Flanger Sweep","Sweeps the phase up or down.", 10,"flangerSweep",0,-1,1,3},
+
+    {"LP Filter Cutoff","Frequency at which the low-pass filter starts attenuating higher frequencies.  Named most likely to result in 'Huh why can't I hear anything?' at her high-school grad. ", 11,"lpFilterCutoff",1,0,1,0.3f},
+    {"LP Filter Cutoff Sweep","Sweeps the low-pass cutoff up or down.", 11,"lpFilterCutoffSweep",0,-1,1,1},
+    {"LP Filter Resonance","Changes the attenuation rate for the low-pass filter, changing the timbre.", 11,"lpFilterResonance",0,0,1,1},
+
+    {"HP Filter Cutoff","Frequency at which the high-pass filter starts attenuating lower frequencies.", 12,"hpFilterCutoff",0,0,1,5},
+    {"HP Filter Cutoff Sweep","Sweeps the high-pass cutoff up or down.", 12,"hpFilterCutoffSweep",0,-1,1,1},
+
+    {"Bit Crush","Resamples the audio at a lower frequency.", 14,"bitCrush",0,0,1,4},
+    {"Bit Crush Sweep","Sweeps the Bit Crush filter up or down.", 14,"bitCrushSweep",0,-1,1,5}
+};
 
 
@@ -19,47 +19,84 @@
  */
 #pragma once
 
-#include <map>
-#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <type_traits>
+#include <vector>
 
 #include "Util.h"
 
-class Param
+/**
+ * Compile-time index of every parameter.
+ * Must be kept in the same order as SfxrParams::schema.
+ */
+enum class ParamId : int
 {
-public:
-    Param() = default;
+    waveType,
+    masterVolume,
+    attackTime,
+    sustainTime,
+    sustainPunch,
+    decayTime,
+    compressionAmount,
+    startFrequency,
+    minFrequency,
+    slide,
+    deltaSlide,
+    vibratoDepth,
+    vibratoSpeed,
+    overtones,
+    overtoneFalloff,
+    changeRepeat,
+    changeAmount,
+    changeSpeed,
+    changeAmount2,
+    changeSpeed2,
+    squareDuty,
+    dutySweep,
+    repeatSpeed,
+    flangerOffset,
+    flangerSweep,
+    lpFilterCutoff,
+    lpFilterCutoffSweep,
+    lpFilterResonance,
+    hpFilterCutoff,
+    hpFilterCutoffSweep,
+    bitCrush,
+    bitCrushSweep,
 
-    Param (std::string name_,
-           std::string description_,
-           int grouping_,
-           std::string uid_,
-           float defaultValue_,
-           float minValue_,
-           float maxValue_)
-      : name (name_),
-        description (description_),
-        grouping (grouping_),
-        uid (uid_),
-        defaultValue (defaultValue_),
-        minValue (minValue_),
-        maxValue (maxValue_),
-        currentValue (defaultValue)
-    {
-    }
+    count
+};
 
-    std::string name;
-    std::string description;
-    int grouping = 0;
-    std::string uid;
-    float defaultValue = 0.0f;
-    float minValue = 0.0f;
-    float maxValue = 1.0f;
-    float currentValue = 0.0f;
+/**
+ * Description of a parameter, shared by every SfxrParams through SfxrParams::schema
+ */
+struct Param
+{
+    const char* name;
+    const char* description;
+    int grouping;
+    const char* uid;
+    float defaultValue;
+    float minValue;
+    float maxValue;
+    float randomizationPower;                 // Exponent randomize applies to its uniform value, 1 for none
 };
 
+/**
+ * The values of the parameters of a sound and which of them are locked
+ *
+ * Everything that is the same for every sound lives in the static schema,
+ * so an instance is just the values, a lock mask and its random numbers,
+ * and is trivially copyable.
+ */
 class SfxrParams
 {
 public:
+    static constexpr size_t numParams = size_t (ParamId::count);
+
     //--------------------------------------------------------------------------
     //
     //  Getters / Setters
@@ -71,120 +108,150 @@ public:
         resetParams();
     }
 
-    std::vector<std::string> getParams()
+    /** Returns the uids of all the parameters, in ParamId order */
+    static std::vector<std::string> getParams()
     {
         std::vector<std::string> uids;
-        for (auto& p : params)
+        for (auto& p : schema)
             uids.push_back (p.uid);
 
         return uids;
     }
 
-    std::string getName (std::string param)
+    /** Returns the id of a parameter uid, or ParamId::count if there is no such parameter */
+    static ParamId getParamId (const std::string& param)
     {
-        for (auto p : params)
-            if (p.uid == param)
-                return p.name;
+        for (size_t i = 0; i < numParams; i++)
+            if (std::strcmp (schema[i].uid, param.c_str()) == 0)
+                return ParamId (i);
 
-        return {};
+        return ParamId::count;
     }
 
-    std::string getDescription (std::string param)
+    /** Returns the description of a parameter */
+    static const Param& getInfo (ParamId param)
     {
-        for (auto p : params)
-            if (p.uid == param)
-                return p.description;
+        return schema[size_t (param)];
+    }
 
-        return {};
+    static std::string getName (const std::string& param)
+    {
+        auto id = getParamId (param);
+        return id != ParamId::count ? schema[size_t (id)].name : std::string();
     }
 
-    float getDefault (std::string param)
+    static std::string getDescription (const std::string& param)
     {
-        return getProperty (param, 4);
+        auto id = getParamId (param);
+        return id != ParamId::count ? schema[size_t (id)].description : std::string();
     }
-    
-    float getMin (std::string param)
+
+    static float getDefault (const std::string& param)
     {
-        return getProperty (param, 5);
+        auto id = getParamId (param);
+        return id != ParamId::count ? getDefault (id) : 0.0f;
     }
     
-    float getMax (std::string param)
+    static float getMin (const std::string& param)
     {
-        return getProperty (param, 6);
+        auto id = getParamId (param);
+        return id != ParamId::count ? getMin (id) : 0.0f;
     }
     
-    float getProperty (std::string param, int index)
+    static float getMax (const std::string& param)
     {
-        for (auto p : params)
-        {
-            if (p.uid == param)
-            {
-                switch (index)
-                {
-                    case 4: return p.defaultValue;
-                    case 5: return p.minValue;
-                    case 6: return p.maxValue;
-                    case 7: return p.currentValue;
-                    default: return 0;
-                }
-            }
-        }
-        return 0;
+        auto id = getParamId (param);
+        return id != ParamId::count ? getMax (id) : 0.0f;
     }
     
-    float getParam (std::string param)
+    float getParam (const std::string& param) const
     {
-        return getProperty (param, 7);
+        auto id = getParamId (param);
+        return id != ParamId::count ? getParam (id) : 0.0f;
     }
     
-    void setParam (std::string param, float value)
+    void setParam (const std::string& param, float value)
     {
-        for (auto& p : params)
-            if (p.uid == param)
-                p.currentValue = clamp (value, getMin (param), getMax (param));
-        
+        auto id = getParamId (param);
+        if (id != ParamId::count)
+            setParam (id, value);
+        else
+            paramsDirty = true;
+    }
+
+    //--------------------------------------------------------------------------
+    //
+    //  Typed Getters / Setters
+    //
+    //--------------------------------------------------------------------------
+
+    static float getDefault (ParamId param) { return schema[size_t (param)].defaultValue; }
+    static float getMin (ParamId param)     { return schema[size_t (param)].minValue; }
+    static float getMax (ParamId param)     { return schema[size_t (param)].maxValue; }
+    float getParam (ParamId param) const    { return values[size_t (param)]; }
+
+    void setParam (ParamId param, float value)
+    {
+        const auto& p = schema[size_t (param)];
+        values[size_t (param)] = clamp (value, p.minValue, p.maxValue);
+
         paramsDirty = true;
     }
     
     /** Returns true if this parameter is locked */
-    bool lockedParam (std::string param)
+    bool lockedParam (const std::string& param) const
     {
-        return std::find (lockedParams.begin(), lockedParams.end(), param) != lockedParams.end();
+        auto id = getParamId (param);
+        return id != ParamId::count && lockedParam (id);
+    }
+
+    bool lockedParam (ParamId param) const
+    {
+        return (lockedMask & lockBit (param)) != 0;
     }
     
     void setAllLocked (bool locked)
     {
-        lockedParams.clear();
-        
-        if (locked)
-            for (auto p : params)
-                lockedParams.push_back (p.uid);
-
+        lockedMask = locked ? allLocked : 0;
         paramsDirty = true;
     }
     
-    void setParamLocked (std::string param, bool locked)
+    /** Locks or unlocks a parameter, unknown uids are ignored */
+    void setParamLocked (const std::string& param, bool locked)
     {
-        auto itr = std::find (lockedParams.begin(), lockedParams.end(), param);
-        
-        if (locked)
-        {
-            if (itr == lockedParams.end())
-            {
-                lockedParams.push_back (param);
-                paramsDirty = true;
-            }
-        }
-        else
+        auto id = getParamId (param);
+        if (id != ParamId::count)
+            setParamLocked (id, locked);
+    }
+
+    void setParamLocked (ParamId param, bool locked)
+    {
+        uint32_t mask = locked ? lockedMask | lockBit (param) : lockedMask & ~lockBit (param);
+        if (mask != lockedMask)
         {
-            if (itr != lockedParams.end())
-            {
-                lockedParams.erase (itr);
-                paramsDirty = true;
-            }
+            lockedMask = mask;
+            paramsDirty = true;
         }
     }
     
+    /** Returns a bit per ParamId, set for the locked parameters */
+    uint32_t getLockedMask() const
+    {
+        return lockedMask;
+    }
+    
+    void setLockedMask (uint32_t mask)
+    {
+        lockedMask = mask & allLocked;
+        paramsDirty = true;
+    }
+    
+    /** Seeds the random numbers used by the generate, randomize and mutate methods */
+    void setSeed (uint64_t seed)
+    {
+        rng.setSeed (seed);
+    }
+    
     //--------------------------------------------------------------------------
     //
     //  Generator Methods
@@ -195,22 +262,27 @@ public:
      * Sets the parameters to generate a pickup/coin sound
      */
     void generatePickupCoin()
+    {
+        generatePickupCoin (rng);
+    }
+    
+    void generatePickupCoin (SfxrRandom& random)
     {
         resetParams();
         
-        setParam ("startFrequency", 0.4f + float (uniformRandom()) * 0.5f);
+        setParam (ParamId::startFrequency, 0.4f + float (random.uniform()) * 0.5f);
         
-        setParam ("sustainTime", float (uniformRandom()) * 0.1f);
-        setParam ("decayTime", 0.1f + float (uniformRandom()) * 0.4f);
-        setParam ("sustainPunch", 0.3f + float (uniformRandom()) * 0.3f);
+        setParam (ParamId::sustainTime, float (random.uniform()) * 0.1f);
+        setParam (ParamId::decayTime, 0.1f + float (random.uniform()) * 0.4f);
+        setParam (ParamId::sustainPunch, 0.3f + float (random.uniform()) * 0.3f);
         
-        if (float (uniformRandom()) < 0.5)
+        if (float (random.uniform()) < 0.5)
         {
-            setParam ("changeSpeed", 0.5f + float (uniformRandom()) * 0.2f);
-            int cnum = int (float (uniformRandom()) * 7) + 1;
-            int cden = cnum + int (float (uniformRandom()) * 7) + 2;
+            setParam (ParamId::changeSpeed, 0.5f + float (random.uniform()) * 0.2f);
+            int cnum = int (float (random.uniform()) * 7) + 1;
+            int cden = cnum + int (float (random.uniform()) * 7) + 2;
             
-            setParam ("changeAmount", float(cnum)/float(cden));
+            setParam (ParamId::changeAmount, float(cnum)/float(cden));
         }
     }
     
@@ -218,94 +290,104 @@ public:
      * Sets the parameters to generate a laser/shoot sound
      */
     void generateLaserShoot()
+    {
+        generateLaserShoot (rng);
+    }
+    
+    void generateLaserShoot (SfxrRandom& random)
     {
         resetParams();
         
-        setParam ("waveType", float (int (uniformRandom() * 3)));
-        if (int (getParam ("waveType")) == 2 && float (uniformRandom()) < 0.5)
-            setParam ("waveType", float (int (uniformRandom() * 2)));
+        setParam (ParamId::waveType, float (int (random.uniform() * 3)));
+        if (int (getParam (ParamId::waveType)) == 2 && float (random.uniform()) < 0.5)
+            setParam (ParamId::waveType, float (int (random.uniform() * 2)));
         
-        setParam ("startFrequency", 0.5f + float (uniformRandom()) * 0.5f);
-        setParam ("minFrequency", getParam ("startFrequency") - 0.2f - float (uniformRandom()) * 0.6f);
+        setParam (ParamId::startFrequency, 0.5f + float (random.uniform()) * 0.5f);
+        setParam (ParamId::minFrequency, getParam (ParamId::startFrequency) - 0.2f - float (random.uniform()) * 0.6f);
         
-        if (getParam ("minFrequency") < 0.2f)
-            setParam ("minFrequency", 0.2f);
+        if (getParam (ParamId::minFrequency) < 0.2f)
+            setParam (ParamId::minFrequency, 0.2f);
         
-        setParam ("slide", -0.15f - float (uniformRandom()) * 0.2f);
+        setParam (ParamId::slide, -0.15f - float (random.uniform()) * 0.2f);
          
-        if (float (uniformRandom()) < 0.33f)
+        if (float (random.uniform()) < 0.33f)
         {
-            setParam ("startFrequency", float (uniformRandom()) * 0.6f);
-            setParam ("minFrequency", float (uniformRandom()) * 0.1f);
-            setParam ("slide", -0.35f - float (uniformRandom()) * 0.3f);
+            setParam (ParamId::startFrequency, float (random.uniform()) * 0.6f);
+            setParam (ParamId::minFrequency, float (random.uniform()) * 0.1f);
+            setParam (ParamId::slide, -0.35f - float (random.uniform()) * 0.3f);
         }
         
-        if (float (uniformRandom()) < 0.5f)
+        if (float (random.uniform()) < 0.5f)
         {
-            setParam ("squareDuty", float (uniformRandom()) * 0.5f);
-            setParam ("dutySweep", float (uniformRandom()) * 0.2f);
+            setParam (ParamId::squareDuty, float (random.uniform()) * 0.5f);
+            setParam (ParamId::dutySweep, float (random.uniform()) * 0.2f);
         }
         else
         {
-            setParam ("squareDuty", 0.4f + float (uniformRandom()) * 0.5f);
-            setParam ("dutySweep", -float (uniformRandom()) * 0.7f);
+            setParam (ParamId::squareDuty, 0.4f + float (random.uniform()) * 0.5f);
+            setParam (ParamId::dutySweep, -float (random.uniform()) * 0.7f);
         }
         
-        setParam ("sustainTime", 0.1f + float (uniformRandom()) * 0.2f);
-        setParam ("decayTime", float (uniformRandom()) * 0.4f);
-        if (float (uniformRandom()) < 0.5f) setParam ("sustainPunch", float (uniformRandom()) * 0.3f);
+        setParam (ParamId::sustainTime, 0.1f + float (random.uniform()) * 0.2f);
+        setParam (ParamId::decayTime, float (random.uniform()) * 0.4f);
+        if (float (random.uniform()) < 0.5f) setParam (ParamId::sustainPunch, float (random.uniform()) * 0.3f);
         
-        if (float (uniformRandom()) < 0.33f)
+        if (float (random.uniform()) < 0.33f)
         {
-            setParam ("flangerOffset", float (uniformRandom()) * 0.2f);
-            setParam ("flangerSweep", -float (uniformRandom()) * 0.2f);
+            setParam (ParamId::flangerOffset, float (random.uniform()) * 0.2f);
+            setParam (ParamId::flangerSweep, -float (random.uniform()) * 0.2f);
         }
         
-        if (float (uniformRandom()) < 0.5)
-            setParam ("hpFilterCutoff", float (uniformRandom()) * 0.3f);
+        if (float (random.uniform()) < 0.5)
+            setParam (ParamId::hpFilterCutoff, float (random.uniform()) * 0.3f);
     }
     
     /**
      * Sets the parameters to generate an explosion sound
      */
     void generateExplosion()
+    {
+        generateExplosion (rng);
+    }
+    
+    void generateExplosion (SfxrRandom& random)
     {
         resetParams();
-        setParam ("waveType", 3);
+        setParam (ParamId::waveType, 3);
         
-        if (float (uniformRandom()) < 0.5f)
+        if (float (random.uniform()) < 0.5f)
         {
-            setParam ("startFrequency", 0.1f + float (uniformRandom()) * 0.4f);
-            setParam ("slide", -0.1f + float (uniformRandom()) * 0.4f);
+            setParam (ParamId::startFrequency, 0.1f + float (random.uniform()) * 0.4f);
+            setParam (ParamId::slide, -0.1f + float (random.uniform()) * 0.4f);
         }
         else
         {
-            setParam ("startFrequency", 0.2f + float (uniformRandom()) * 0.7f);
-            setParam ("slide", -0.2f - float (uniformRandom()) * 0.2f);
+            setParam (ParamId::startFrequency, 0.2f + float (random.uniform()) * 0.7f);
+            setParam (ParamId::slide, -0.2f - float (random.uniform()) * 0.2f);
         }
         
-        setParam ("startFrequency", getParam ("startFrequency") * getParam ("startFrequency"));
+        setParam (ParamId::startFrequency, getParam (ParamId::startFrequency) * getParam (ParamId::startFrequency));
         
-        if (float (uniformRandom()) < 0.2f)
-            setParam ("slide", 0.0f);
+        if (float (random.uniform()) < 0.2f)
+            setParam (ParamId::slide, 0.0f);
         
-        if (float (uniformRandom()) < 0.33f)
-            setParam ("repeatSpeed", 0.3f + float (uniformRandom()) * 0.5f);
+        if (float (random.uniform()) < 0.33f)
+            setParam (ParamId::repeatSpeed, 0.3f + float (random.uniform()) * 0.5f);
         
-        setParam ("sustainTime", 0.1f + float (uniformRandom()) * 0.3f);
-        setParam ("decayTime", float (uniformRandom()) * 0.5f);
-        setParam ("sustainPunch", 0.2f + float (uniformRandom()) * 0.6f);
+        setParam (ParamId::sustainTime, 0.1f + float (random.uniform()) * 0.3f);
+        setParam (ParamId::decayTime, float (random.uniform()) * 0.5f);
+        setParam (ParamId::sustainPunch, 0.2f + float (random.uniform()) * 0.6f);
         
-        if (float (uniformRandom()) < 0.5f)
+        if (float (random.uniform()) < 0.5f)
         {
-            setParam ("flangerOffset", -0.3f + float (uniformRandom()) * 0.9f);
-            setParam ("flangerSweep", -float (uniformRandom()) * 0.3f);
+            setParam (ParamId::flangerOffset, -0.3f + float (random.uniform()) * 0.9f);
+            setParam (ParamId::flangerSweep, -float (random.uniform()) * 0.3f);
         }
         
-        if (float (uniformRandom()) < 0.33f)
+        if (float (random.uniform()) < 0.33f)
         {
-            setParam ("changeSpeed", 0.6f + float (uniformRandom()) * 0.3f);
-            setParam ("changeAmount", 0.8f - float (uniformRandom()) * 1.6f);
+            setParam (ParamId::changeSpeed, 0.6f + float (random.uniform()) * 0.3f);
+            setParam (ParamId::changeAmount, 0.8f - float (random.uniform()) * 1.6f);
         }
     }
     
@@ -313,94 +395,134 @@ public:
      * Sets the parameters to generate a powerup sound
      */
     void generatePowerup()
+    {
+        generatePowerup (rng);
+    }
+    
+    void generatePowerup (SfxrRandom& random)
     {
         resetParams();
         
-        if (float (uniformRandom()) < 0.5f)
-            setParam ("waveType", 1);
+        if (float (random.uniform()) < 0.5f)
+            setParam (ParamId::waveType, 1);
         else
-            setParam ("squareDuty", float (uniformRandom()) * 0.6f);
+            setParam (ParamId::squareDuty, float (random.uniform()) * 0.6f);
         
-        if (float (uniformRandom()) < 0.5f)
+        if (float (random.uniform()) < 0.5f)
         {
-            setParam ("startFrequency", 0.2f + float (uniformRandom()) * 0.3f);
-            setParam ("slide", 0.1f + float (uniformRandom()) * 0.4f);
-            setParam ("repeatSpeed", 0.4f + float (uniformRandom()) * 0.4f);
+            setParam (ParamId::startFrequency, 0.2f + float (random.uniform()) * 0.3f);
+            setParam (ParamId::slide, 0.1f + float (random.uniform()) * 0.4f);
+            setParam (ParamId::repeatSpeed, 0.4f + float (random.uniform()) * 0.4f);
         }
         else
         {
-            setParam ("startFrequency", 0.2f + float (uniformRandom()) * 0.3f);
-            setParam ("slide", 0.05f + float (uniformRandom()) * 0.2f);
+            setParam (ParamId::startFrequency, 0.2f + float (random.uniform()) * 0.3f);
+            setParam (ParamId::slide, 0.05f + float (random.uniform()) * 0.2f);
             
-            if (float (uniformRandom()) < 0.5f)
+            if (float (random.uniform()) < 0.5f)
             {
-                setParam ("vibratoDepth", float (uniformRandom()) * 0.7f);
-                setParam ("vibratoSpeed", float (uniformRandom()) * 0.6f);
+                setParam (ParamId::vibratoDepth, float (random.uniform()) * 0.7f);
+                setParam (ParamId::vibratoSpeed, float (random.uniform()) * 0.6f);
             }
         }
         
-        setParam ("sustainTime", float (uniformRandom()) * 0.4f);
-        setParam ("decayTime", 0.1f + float (uniformRandom()) * 0.4f);
+        setParam (ParamId::sustainTime, float (random.uniform()) * 0.4f);
+        setParam (ParamId::decayTime, 0.1f + float (random.uniform()) * 0.4f);
     }
     
     /**
      * Sets the parameters to generate a hit/hurt sound
      */
     void generateHitHurt()
+    {
+        generateHitHurt (rng);
+    }
+    
+    void generateHitHurt (SfxrRandom& random)
     {
         resetParams();
         
-        setParam ("waveType", float (int (uniformRandom() * 3)));
-        if (int (getParam ("waveType")) == 2)
-            setParam ("waveType", 3);
-        else if (int (getParam ("waveType")) == 0)
-            setParam ("squareDuty", float (uniformRandom()) * 0.6f);
+        setParam (ParamId::waveType, float (int (random.uniform() * 3)));
+        if (int (getParam (ParamId::waveType)) == 2)
+            setParam (ParamId::waveType, 3);
+        else if (int (getParam (ParamId::waveType)) == 0)
+            setParam (ParamId::squareDuty, float (random.uniform()) * 0.6f);
         
-        setParam ("startFrequency", 0.2f + float (uniformRandom()) * 0.6f);
-        setParam ("slide", -0.3f - float (uniformRandom()) * 0.4f);
+        setParam (ParamId::startFrequency, 0.2f + float (random.uniform()) * 0.6f);
+        setParam (ParamId::slide, -0.3f - float (random.uniform()) * 0.4f);
         
-        setParam ("sustainTime", float (uniformRandom()) * 0.1f);
-        setParam ("decayTime", 0.1f + float (uniformRandom()) * 0.2f);
+        setParam (ParamId::sustainTime, float (random.uniform()) * 0.1f);
+        setParam (ParamId::decayTime, 0.1f + float (random.uniform()) * 0.2f);
         
-        if (float (uniformRandom()) < 0.5f)
-            setParam ("hpFilterCutoff", float (uniformRandom()) * 0.3f);
+        if (float (random.uniform()) < 0.5f)
+            setParam (ParamId::hpFilterCutoff, float (random.uniform()) * 0.3f);
     }
     
     /**
      * Sets the parameters to generate a jump sound
      */
     void generateJump()
+    {
+        generateJump (rng);
+    }
+    
+    void generateJump (SfxrRandom& random)
     {
         resetParams();
         
-        setParam ("waveType", 0);
-        setParam ("squareDuty", float (uniformRandom()) * 0.6f);
-        setParam ("startFrequency", 0.3f + float (uniformRandom()) * 0.3f);
-        setParam ("slide", 0.1f + float (uniformRandom()) * 0.2f);
+        setParam (ParamId::waveType, 0);
+        setParam (ParamId::squareDuty, float (random.uniform()) * 0.6f);
+        setParam (ParamId::startFrequency, 0.3f + float (random.uniform()) * 0.3f);
+        setParam (ParamId::slide, 0.1f + float (random.uniform()) * 0.2f);
         
-        setParam ("sustainTime", 0.1f + float (uniformRandom()) * 0.3f);
-        setParam ("decayTime", 0.1f + float (uniformRandom()) * 0.2f);
+        setParam (ParamId::sustainTime, 0.1f + float (random.uniform()) * 0.3f);
+        setParam (ParamId::decayTime, 0.1f + float (random.uniform()) * 0.2f);
         
-        if (float (uniformRandom()) < 0.5f) setParam ("hpFilterCutoff", float (uniformRandom()) * 0.3f);
-        if (float (uniformRandom()) < 0.5f) setParam ("lpFilterCutoff", 1.0f - float (uniformRandom()) * 0.6f);
+        if (float (random.uniform()) < 0.5f) setParam (ParamId::hpFilterCutoff, float (random.uniform()) * 0.3f);
+        if (float (random.uniform()) < 0.5f) setParam (ParamId::lpFilterCutoff, 1.0f - float (random.uniform()) * 0.6f);
     }
     
     /**
      * Sets the parameters to generate a blip/select sound
      */
     void generateBlipSelect()
+    {
+        generateBlipSelect (rng);
+    }
+    
+    void generateBlipSelect (SfxrRandom& random)
     {
         resetParams();
         
-        setParam ("waveType", float (int (uniformRandom() * 2)));
-        if (int (getParam ("waveType")) == 0)
-            setParam ("squareDuty", float (uniformRandom()) * 0.6f);
+        setParam (ParamId::waveType, float (int (random.uniform() * 2)));
+        if (int (getParam (ParamId::waveType)) == 0)
+            setParam (ParamId::squareDuty, float (random.uniform()) * 0.6f);
         
-        setParam ("startFrequency", 0.2f + float (uniformRandom()) * 0.4f);
+        setParam (ParamId::startFrequency, 0.2f + float (random.uniform()) * 0.4f);
         
-        setParam ("sustainTime", 0.1f + float (uniformRandom()) * 0.1f);
-        setParam ("decayTime", float (uniformRandom()) * 0.2f);
-        setParam ("hpFilterCutoff", 0.1f);
+        setParam (ParamId::sustainTime, 0.1f + float (random.uniform()) * 0.1f);
+        setParam (ParamId::decayTime, float (random.uniform()) * 0.2f);
+        setParam (ParamId::hpFilterCutoff, 0.1f);
+    }
+    
+    /**
+     * Sets the parameters from a generator category by name: pickupCoin,
+     * laserShoot, explosion, powerup, hitHurt, jump, blipSelect or random
+     * @return				False for an unknown category, leaving the params unchanged
+     */
+    bool generate (const std::string& category, SfxrRandom& random)
+    {
+        if (category == "pickupCoin")           generatePickupCoin (random);
+        else if (category == "laserShoot")      generateLaserShoot (random);
+        else if (category == "explosion")       generateExplosion (random);
+        else if (category == "powerup")         generatePowerup (random);
+        else if (category == "hitHurt")         generateHitHurt (random);
+        else if (category == "jump")            generateJump (random);
+        else if (category == "blipSelect")      generateBlipSelect (random);
+        else if (category == "random")          randomize (random);
+        else                                    return false;
+        
+        return true;
     }
     
     /**
@@ -410,11 +532,10 @@ public:
     {
         paramsDirty = true;
         
-        for (auto& p : params)
-            p.currentValue = p.defaultValue;
+        for (size_t i = 0; i < numParams; i++)
+            values[i] = schema[i].defaultValue;
     
-        lockedParams.clear();
-        lockedParams.push_back ("masterVolume");
+        lockedMask = lockBit (ParamId::masterVolume);
     }
     
     //--------------------------------------------------------------------------
@@ -428,40 +549,39 @@ public:
      */
     void mutate (float mutation = 0.05f)
     {
-        for (auto& p : params)
+        mutate (rng, mutation);
+    }
+    
+    void mutate (SfxrRandom& random, float mutation = 0.05f)
+    {
+        for (size_t i = 0; i < numParams; i++)
         {
-            if (! lockedParam(p.uid))
+            if (! lockedParam (ParamId (i)))
             {
-                if (float (uniformRandom()) < 0.5f)
+                if (float (random.uniform()) < 0.5f)
                 {
-                    setParam (p.uid, p.currentValue + float (uniformRandom()) * mutation * 2 - mutation);
+                    setParam (ParamId (i), values[i] + float (random.uniform()) * mutation * 2 - mutation);
                 }
             }
         }
     }
     
-    //some constants used for weighting random values
+    /**
+     * Takes each unlocked parameter from another set of params half of the time
+     * Locked parameters keep their values, whatever the other params hold
+     */
+    void crossover (const SfxrParams& other, SfxrRandom& random)
+    {
+        for (size_t i = 0; i < numParams; i++)
+        {
+            if (! lockedParam (ParamId (i)) && float (random.uniform()) < 0.5f)
+                setParam (ParamId (i), other.values[i]);
+        }
+    }
     
-    std::map<std::string, float> randomizationPower
-    {
-        { "attackTime", 4.0f},
-        { "sustainTime", 2.0f},
-        { "sustainPunch", 2.0f},
-        { "overtones", 3.0f},
-        { "overtoneFalloff", 0.25f},
-        { "vibratoDepth", 3.0f},
-        { "dutySweep", 3.0f},
-        { "flangerOffset", 3.0f},
-        { "flangerSweep", 3.0f},
-        { "lpFilterCutoff", 0.3f},
-        { "lpFilterSweep", 3.0f},
-        { "hpFilterCutoff", 5.0f},
-        { "hpFilterSweep", 5.0f},
-        { "bitCrush", 4.0f},
-        { "bitCrushSweep", 5.0f},
-    };
+    //some constants used for weighting random values
     
-    std::vector<int> waveTypeWeights =
+    static constexpr int waveTypeWeights[] =
     {
         1,//0:square
         1,//1:saw
@@ -480,91 +600,96 @@ public:
      */
     void randomize()
     {
-        for (auto& p : params)
+        randomize (rng);
+    }
+    
+    void randomize (SfxrRandom& random)
+    {
+        for (size_t i = 0; i < numParams; i++)
         {
-            if (! lockedParam (p.uid))
+            if (! lockedParam (ParamId (i)))
             {
-                auto min = getMin (p.uid);
-                auto max = getMax (p.uid);
+                const auto& p = schema[i];
+                auto min = p.minValue;
+                auto max = p.maxValue;
                 
-                auto r = float (uniformRandom());
+                auto r = float (random.uniform());
                 
-                auto itr = randomizationPower.find (p.uid);
-                if (itr != randomizationPower.end())
-                    r = std::pow (r, itr->second);
+                if (p.randomizationPower != 1.0f)
+                    r = std::pow (r, p.randomizationPower);
                 
-                p.currentValue = min + ( max - min) * r;
+                values[i] = min + ( max - min) * r;
             }
         }
         
         paramsDirty = true;
         
-        if (! lockedParam ("waveType"))
+        if (! lockedParam (ParamId::waveType))
         {
             int count = 0;
             for (auto weight : waveTypeWeights)
                 count += weight;
             
-            float r = float (uniformRandom()) * count;
-            for (size_t i = 0; i < waveTypeWeights.size(); i++)
+            float r = float (random.uniform()) * count;
+            for (size_t i = 0; i < std::size (waveTypeWeights); i++)
             {
                 r -= waveTypeWeights[i];
                 if (r <= 0)
                 {
-                    setParam ("waveType", float (i));
+                    setParam (ParamId::waveType, float (i));
                     break;
                 }
             }
             
         }
         
-        if (! lockedParam ("repeatSpeed"))
+        if (! lockedParam (ParamId::repeatSpeed))
         {
-            if (float (uniformRandom()) < 0.5f)
-                setParam ("repeatSpeed", 0.0f);
+            if (float (random.uniform()) < 0.5f)
+                setParam (ParamId::repeatSpeed, 0.0f);
         }
         
-        if (! lockedParam ("slide"))
+        if (! lockedParam (ParamId::slide))
         {
-            float r = float (uniformRandom()) * 2 - 1;
+            float r = float (random.uniform()) * 2 - 1;
             r = std::pow (r, 5.0f);
-            setParam ("slide", r);
+            setParam (ParamId::slide, r);
         }
-        if (! lockedParam ("deltaSlide"))
+        if (! lockedParam (ParamId::deltaSlide))
         {
-            float r = float (uniformRandom()) * 2 - 1;
+            float r = float (random.uniform()) * 2 - 1;
             r=std::pow (r, 3.0f);
-            setParam ("deltaSlide", r);
+            setParam (ParamId::deltaSlide, r);
         }
         
-        if (! lockedParam ("minFrequency"))
-            setParam ("minFrequency", 0);
+        if (! lockedParam (ParamId::minFrequency))
+            setParam (ParamId::minFrequency, 0);
         
-        if (! lockedParam ("startFrequency"))
-            setParam("startFrequency", (float (uniformRandom()) < 0.5f) ? std::pow (float (uniformRandom()) * 2 - 1, 2.0f) : (std::pow (float (uniformRandom()) * 0.5f, 3.0f) + 0.5f));
+        if (! lockedParam (ParamId::startFrequency))
+            setParam (ParamId::startFrequency, (float (random.uniform()) < 0.5f) ? std::pow (float (random.uniform()) * 2 - 1, 2.0f) : (std::pow (float (random.uniform()) * 0.5f, 3.0f) + 0.5f));
         
-        if ((! lockedParam("sustainTime")) && (! lockedParam("decayTime")))
+        if ((! lockedParam (ParamId::sustainTime)) && (! lockedParam (ParamId::decayTime)))
         {
-            if (getParam ("attackTime") + getParam ("sustainTime") + getParam ("decayTime") < 0.2f)
+            if (getParam (ParamId::attackTime) + getParam (ParamId::sustainTime) + getParam (ParamId::decayTime) < 0.2f)
             {
-                setParam ("sustainTime", 0.2f + float (uniformRandom()) * 0.3f);
-                setParam ("decayTime", 0.2f + float (uniformRandom()) * 0.3f);
+                setParam (ParamId::sustainTime, 0.2f + float (random.uniform()) * 0.3f);
+                setParam (ParamId::decayTime, 0.2f + float (random.uniform()) * 0.3f);
             }
         }
         
-        if (! lockedParam ("slide"))
+        if (! lockedParam (ParamId::slide))
         {
-            if ((getParam ("startFrequency") > 0.7 && getParam ("slide") > 0.2f) || (getParam ("startFrequency") < 0.2f && getParam ("slide") < -0.05))
+            if ((getParam (ParamId::startFrequency) > 0.7 && getParam (ParamId::slide) > 0.2f) || (getParam (ParamId::startFrequency) < 0.2f && getParam (ParamId::slide) < -0.05))
             {
-                setParam ("slide", -getParam("slide"));
+                setParam (ParamId::slide, -getParam (ParamId::slide));
             }
         }
         
-        if (! lockedParam ("lpFilterCutoffSweep"))
+        if (! lockedParam (ParamId::lpFilterCutoffSweep))
         {
-            if (getParam ("lpFilterCutoff") < 0.1f && getParam ("lpFilterCutoffSweep") < -0.05)
+            if (getParam (ParamId::lpFilterCutoff) < 0.1f && getParam (ParamId::lpFilterCutoffSweep) < -0.05)
             {
-                setParam ("lpFilterCutoffSweep", -getParam ("lpFilterCutoffSweep"));
+                setParam (ParamId::lpFilterCutoffSweep, -getParam (ParamId::lpFilterCutoffSweep));
             }
         }
     }
@@ -580,7 +705,7 @@ public:
      * @param	value	Input value
      * @return			The value clamped between 0 and 1
      */
-    inline float clamp1 (float value)
+    static inline float clamp1 (float value)
     {
         return (value > 1.0f) ? 1.0f : ((value < 0.0f) ? 0.0f : value);
     }
@@ -590,7 +715,7 @@ public:
      * @param	value	Input value
      * @return			The value clamped between -1 and 1
      */
-    inline float clamp2 (float value)
+    static inline float clamp2 (float value)
     {
         return (value > 1.0f) ? 1.0f : ((value < -1.0f) ? -1.0f : value);
     }
@@ -602,7 +727,7 @@ public:
      * @param	max		max value
      * @return			The value clamped between min and max
      */
-    inline float clamp (float value, float min, float max)
+    static inline float clamp (float value, float min, float max)
     {
         return (value > max) ? max : ((value < min) ? min : value);
     }
@@ -613,67 +738,33 @@ public:
     //
     //--------------------------------------------------------------------------
     
-    static const int WAVETYPECOUNT;
+    static constexpr int WAVETYPECOUNT = 9;
     
     /** If the parameters have been changed since last time (shouldn't used cached sound) */
     bool paramsDirty = true;
     
+    /** Random numbers for the generate, randomize and mutate methods that don't take an SfxrRandom */
+    SfxrRandom rng;
+    
     //interface uses this to disable square sliders when non-square wavetype selected
-    std::vector<std::string> squareParams = {"squareDuty","dutySweep"};
+    static constexpr ParamId squareParams[] = { ParamId::squareDuty, ParamId::dutySweep };
     
     //params to exclude from list
-    std::vector<std::string> excludeParams = {"waveType", "masterVolume"};
+    static constexpr ParamId excludeParams[] = { ParamId::waveType, ParamId::masterVolume };
     
-    std::vector<Param> params = {
-        // real name, decription, grouping,name, default, min, max,
-        {"Wave Type","Shape of the wave.", 0,"waveType",2,0,WAVETYPECOUNT-1.0f}, // the 6.999 thing is because this is really an int parameter...
-        
-        {"Master Volume","Overall volume of the sound.", 1,"masterVolume",0.5f,0,1},
-        {"Attack Time","Length of the volume envelope attack.", 1,"attackTime",0,0,1},
-        {"Sustain Time","Length of the volume envelope sustain.", 1,"sustainTime",0.3f,0,1},
-        {"Punch","Tilts the sustain envelope for more 'pop'.", 1,"sustainPunch",0,0,1},
-        {"Decay Time","Length of the volume envelope decay (yes, I know it's called release).", 1,"decayTime",0.4f,0,1},
-        
-        {"Compression","Pushes amplitudes together into a narrower range to make them stand out more.  Very good for sound effects, where you want them to stick out against background music.",15,"compressionAmount",0.3f,0,1},
-        
-        {"Frequency","Base note of the sound.", 2,"startFrequency",0.3f,0,1},
-        {"Frequency Cutoff","If sliding, the sound will stop at this frequency, to prevent really low notes.  If unlocked, this is set to zero during randomization.", 2,"minFrequency",0.0f,0,1},
-        
-        {"Frequency Slide","Slides the frequency up or down.", 3, "slide",0.0f,-1,1},
-        {"Delta Slide","Accelerates the frequency slide.  Can be used to get the frequency to change direction.", 3,"deltaSlide",0.0f,-1,1},
-        
-        {"Vibrato Depth","Strength of the vibrato effect.", 4,"vibratoDepth",0,0,1},
-        {"Vibrato Speed","Speed of the vibrato effect (i.e. frequency).", 4,"vibratoSpeed",0,0,1},
-        
-        {"Harmonics","Overlays copies of the waveform with copies and multiples of its frequency.  Good for bulking out or otherwise enriching the texture of the sounds (warning: this is the number 1 cause of bfxr slowdown!).", 13,"overtones",0,0,1},
-        {"Harmonics Falloff","The rate at which higher overtones should decay.", 13,"overtoneFalloff",0,0,1},
-        
-        {"Pitch Jump Repeat Speed","Larger Values means more pitch jumps, which can be useful for arpeggiation.", 5,"changeRepeat",0,0,1},
-        {"Pitch Jump Amount 1","Jump in pitch, either up or down.", 5,"changeAmount",0,-1,1},
-        {"Pitch Jump Onset 1","How quickly the note shift happens.", 5,"changeSpeed",0,0,1},
-        {"Pitch Jump Amount 2","Jump in pitch, either up or down.", 5,"changeAmount2",0,-1,1},
-        {"Pitch Jump Onset 2","How quickly the note shift happens.", 5,"changeSpeed2",0,0,1},
-        
-        {"Square Duty","Square waveform only : Controls the ratio between the up and down states of the square wave, changing the tibre.", 8,"squareDuty",0,0,1},
-        {"Duty Sweep","Square waveform only : Sweeps the duty up or down.", 8,"dutySweep",0,-1,1},
-        
-        {"Repeat Speed","Speed of the note repeating - certain variables are reset each time.", 9,"repeatSpeed",0,0,1},
-        
-        {"Flanger Offset","Offsets a second copy of the wave by a small phase, changing the tibre.", 10,"flangerOffset",0,-1,1},
-        {"Flanger Sweep","Sweeps the phase up or down.", 10,"flangerSweep",0,-1,1},
-        
-        {"LP Filter Cutoff","Frequency at which the low-pass filter starts attenuating higher frequencies.  Named most likely to result in 'Huh why can't I hear anything?' at her high-school grad. ", 11,"lpFilterCutoff",1,0,1},
-        {"LP Filter Cutoff Sweep","Sweeps the low-pass cutoff up or down.", 11,"lpFilterCutoffSweep",0,-1,1},
-        {"LP Filter Resonance","Changes the attenuation rate for the low-pass filter, changing the timbre.", 11,"lpFilterResonance",0,0,1},
-        
-        {"HP Filter Cutoff","Frequency at which the high-pass filter starts attenuating lower frequencies.", 12,"hpFilterCutoff",0,0,1},
-        {"HP Filter Cutoff Sweep","Sweeps the high-pass cutoff up or down.", 12,"hpFilterCutoffSweep",0,-1,1},
-        
-        {"Bit Crush","Resamples the audio at a lower frequency.", 14,"bitCrush",0,0,1},
-        {"Bit Crush Sweep","Sweeps the Bit Crush filter up or down.", 14,"bitCrushSweep",0,-1,1}
-        
-    };
+    /** Names, ranges and defaults of the parameters, in ParamId order */
+    static const Param schema[numParams];
     
-    std::vector<std::string> lockedParams; // stores list of strings, these strings represent parameters that will be locked during randomization/mutation
-
+private:
+    static constexpr uint32_t lockBit (ParamId param)
+    {
+        return 1u << unsigned (param);
+    }
+    
+    static constexpr uint32_t allLocked = uint32_t ((uint64_t (1) << numParams) - 1);
+    
+    std::array<float, numParams> values;      // Current value of each parameter
+    uint32_t lockedMask = 0;                  // Bit per ParamId of the parameters randomize and mutate leave alone
 };
+
+static_assert (std::is_trivially_copyable<SfxrParams>::value, "SfxrParams is copied between threads and libraries as plain memory");
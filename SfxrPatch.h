@@ -0,0 +1,239 @@
+/**
+ * SfxrPatch
+ *
+ * Copyright 2010 Thomas Vian
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * 	http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * @author Thomas Vian
+ */
+#pragma once
+
+#include <cmath>
+#include <cstddef>
+
+#include "SfxrParams.h"
+
+/**
+ * The synth variables derived from an SfxrParams, compiled once whenever the
+ * params change. Total and partial resets just copy fields out of it, so they
+ * never look at the params.
+ */
+struct SfxrPatch
+{
+    /** Minimum total length of the envelope, in the same units as the time params */
+    static constexpr float MIN_LENGTH = 0.18f;
+
+    //--------------------------------------------------------------------------
+    //
+    //  Partial Reset Variables
+    //
+    //--------------------------------------------------------------------------
+
+    float period = 0.0f;
+    float maxPeriod = 0.0f;
+
+    float slide = 0.0f;
+    float deltaSlide = 0.0f;
+
+    float squareDuty = 0.0f;
+    float dutySweep = 0.0f;
+
+    float changePeriod = 0.0f;
+    float changeAmount = 0.0f;
+    int changeLimit = 0;
+    float changeAmount2 = 0.0f;
+    int changeLimit2 = 0;
+
+    //--------------------------------------------------------------------------
+    //
+    //  Total Reset Variables
+    //
+    //--------------------------------------------------------------------------
+
+    float attackTime = 0.0f;                  // Envelope times after the minimum length has been applied
+    float sustainTime = 0.0f;
+    float decayTime = 0.0f;
+
+    float masterVolume = 0.0f;
+    unsigned int waveType = 0;
+    float sustainPunch = 0.0f;
+
+    float minFrequency = 0.0f;
+    int overtones = 0;
+    float overtoneFalloff = 0.0f;
+
+    float bitcrushFreq = 0.0f;
+    float bitcrushFreqSweep = 0.0f;
+
+    float compressionFactor = 0.0f;
+
+    bool filters = false;
+    float lpFilterCutoff = 0.0f;
+    float lpFilterDeltaCutoff = 0.0f;
+    float lpFilterDamping = 0.0f;
+    bool lpFilterOn = false;
+
+    float hpFilterCutoff = 0.0f;
+    float hpFilterDeltaCutoff = 0.0f;
+
+    float vibratoSpeed = 0.0f;
+    float vibratoAmplitude = 0.0f;
+
+    float envelopeLength0 = 0.0f;
+    float envelopeLength1 = 0.0f;
+    float envelopeLength2 = 0.0f;
+    float envelopeFullLength = 0.0f;
+    float envelopeOverLength0 = 0.0f;
+    float envelopeOverLength1 = 0.0f;
+    float envelopeOverLength2 = 0.0f;
+
+    bool flanger = false;
+    float flangerOffset = 0.0f;
+    float flangerDeltaOffset = 0.0f;
+
+    int repeatLimit = 0;
+
+    /**
+     * Exact number of samples the sound renders at SfxrSynth::internalSampleRate
+     * The envelope counts whole samples, each stage ends on the first sample
+     * past its length, which starts the next stage at time 0. The attack starts
+     * at time 1, and the sample that ends the decay is rendered silent.
+     */
+    size_t getSampleCount() const
+    {
+        return size_t (envelopeLength0) + size_t (envelopeLength1) + size_t (envelopeLength2) + 3;
+    }
+
+    //--------------------------------------------------------------------------
+    //
+    //  Compile
+    //
+    //--------------------------------------------------------------------------
+
+    /**
+     * Builds a patch from a set of params
+     * The envelope times are clamped the same way SfxrSynth clamps its params,
+     * the clamped values are stored in attackTime, sustainTime and decayTime
+     */
+    static SfxrPatch compile (const SfxrParams& p)
+    {
+        SfxrPatch patch;
+
+        patch.period = 100.0f / (p.getParam (ParamId::startFrequency) * p.getParam (ParamId::startFrequency) + 0.001f);
+        patch.maxPeriod = 100.0f / (p.getParam (ParamId::minFrequency) * p.getParam (ParamId::minFrequency) + 0.001f);
+
+        patch.slide = 1.0f - p.getParam (ParamId::slide) * p.getParam (ParamId::slide) * p.getParam (ParamId::slide) * 0.01f;
+        patch.deltaSlide = -p.getParam (ParamId::deltaSlide) * p.getParam (ParamId::deltaSlide) * p.getParam (ParamId::deltaSlide) * 0.000001f;
+
+        patch.squareDuty = 0.5f - p.getParam (ParamId::squareDuty) * 0.5f;
+        patch.dutySweep = -p.getParam (ParamId::dutySweep) * 0.00005f;
+
+        patch.changePeriod = (((1-p.getParam (ParamId::changeRepeat)) + 0.1f) / 1.1f) * 20000 + 32;
+
+        if (p.getParam (ParamId::changeAmount) > 0.0f)
+            patch.changeAmount = 1.0f - p.getParam (ParamId::changeAmount) * p.getParam (ParamId::changeAmount) * 0.9f;
+        else
+            patch.changeAmount = 1.0f + p.getParam (ParamId::changeAmount) * p.getParam (ParamId::changeAmount) * 10.0f;
+
+        if (p.getParam (ParamId::changeSpeed) == 1.0f)
+            patch.changeLimit = 0;
+        else
+            patch.changeLimit = int ((1.0f - p.getParam (ParamId::changeSpeed)) * (1.0f - p.getParam (ParamId::changeSpeed)) * 20000 + 32);
+
+        if (p.getParam (ParamId::changeAmount2) > 0.0)
+            patch.changeAmount2 = 1.0f - p.getParam (ParamId::changeAmount2) * p.getParam (ParamId::changeAmount2) * 0.9f;
+        else
+            patch.changeAmount2 = 1.0f + p.getParam (ParamId::changeAmount2) * p.getParam (ParamId::changeAmount2) * 10.0f;
+
+        if (p.getParam (ParamId::changeSpeed2) == 1.0f)
+            patch.changeLimit2 = 0;
+        else
+            patch.changeLimit2 = int ((1.0f - p.getParam (ParamId::changeSpeed2)) * (1.0f - p.getParam (ParamId::changeSpeed2)) * 20000 + 32);
+
+        patch.changeLimit  = int (patch.changeLimit * ((1.0f - p.getParam (ParamId::changeRepeat) + 0.1f) / 1.1f));
+        patch.changeLimit2 = int (patch.changeLimit2 * ((1.0f - p.getParam (ParamId::changeRepeat) + 0.1f) / 1.1f));
+
+        patch.masterVolume = p.getParam (ParamId::masterVolume) * p.getParam (ParamId::masterVolume);
+
+        patch.waveType = (unsigned int) (p.getParam (ParamId::waveType));
+
+        // Applies the minimum sustain and total envelope length
+        patch.attackTime = p.getParam (ParamId::attackTime);
+        patch.sustainTime = p.getParam (ParamId::sustainTime);
+        patch.decayTime = p.getParam (ParamId::decayTime);
+
+        if (patch.sustainTime < 0.01f)
+            patch.sustainTime = 0.01f;
+
+        float totalTime = patch.attackTime + patch.sustainTime + patch.decayTime;
+        if (totalTime < MIN_LENGTH)
+        {
+            float multiplier = MIN_LENGTH / totalTime;
+            patch.attackTime = SfxrParams::clamp (patch.attackTime * multiplier, p.getMin (ParamId::attackTime), p.getMax (ParamId::attackTime));
+            patch.sustainTime = SfxrParams::clamp (patch.sustainTime * multiplier, p.getMin (ParamId::sustainTime), p.getMax (ParamId::sustainTime));
+            patch.decayTime = SfxrParams::clamp (patch.decayTime * multiplier, p.getMin (ParamId::decayTime), p.getMax (ParamId::decayTime));
+        }
+
+        patch.sustainPunch = p.getParam (ParamId::sustainPunch);
+
+        patch.minFrequency = p.getParam (ParamId::minFrequency);
+        patch.overtones = int (p.getParam (ParamId::overtones) * 10);
+        patch.overtoneFalloff = p.getParam (ParamId::overtoneFalloff);
+
+        patch.bitcrushFreq = 1 - std::pow (p.getParam (ParamId::bitCrush), 1.0f / 3.0f);
+        patch.bitcrushFreqSweep = - p.getParam (ParamId::bitCrushSweep) * 0.000015f;
+
+        patch.compressionFactor = 1 / (1 + 4 * p.getParam (ParamId::compressionAmount));
+
+        patch.filters = p.getParam (ParamId::lpFilterCutoff) != 1.0f || p.getParam (ParamId::hpFilterCutoff) != 0.0;
+
+        patch.lpFilterCutoff = p.getParam (ParamId::lpFilterCutoff) * p.getParam (ParamId::lpFilterCutoff) * p.getParam (ParamId::lpFilterCutoff) * 0.1f;
+        patch.lpFilterDeltaCutoff = 1.0f + p.getParam (ParamId::lpFilterCutoffSweep) * 0.0001f;
+        patch.lpFilterDamping = 5.0f / (1.0f + p.getParam (ParamId::lpFilterResonance) * p.getParam (ParamId::lpFilterResonance) * 20.0f) * (0.01f + patch.lpFilterCutoff);
+        if (patch.lpFilterDamping > 0.8f)
+            patch.lpFilterDamping = 0.8f;
+        patch.lpFilterDamping = 1.0f - patch.lpFilterDamping;
+        patch.lpFilterOn = p.getParam (ParamId::lpFilterCutoff) != 1.0;
+
+        patch.hpFilterCutoff = p.getParam (ParamId::hpFilterCutoff) * p.getParam (ParamId::hpFilterCutoff) * 0.1f;
+        patch.hpFilterDeltaCutoff = 1.0f + p.getParam (ParamId::hpFilterCutoffSweep) * 0.0003f;
+
+        patch.vibratoSpeed = p.getParam (ParamId::vibratoSpeed) * p.getParam (ParamId::vibratoSpeed) * 0.01f;
+        patch.vibratoAmplitude = p.getParam (ParamId::vibratoDepth) * 0.5f;
+
+        patch.envelopeLength0 = patch.attackTime * patch.attackTime * 100000.0f;
+        patch.envelopeLength1 = patch.sustainTime * patch.sustainTime * 100000.0f;
+        patch.envelopeLength2 = patch.decayTime * patch.decayTime * 100000.0f + 10;
+        patch.envelopeFullLength = patch.envelopeLength0 + patch.envelopeLength1 + patch.envelopeLength2;
+
+        patch.envelopeOverLength0 = 1.0f / patch.envelopeLength0;
+        patch.envelopeOverLength1 = 1.0f / patch.envelopeLength1;
+        patch.envelopeOverLength2 = 1.0f / patch.envelopeLength2;
+
+        patch.flanger = p.getParam (ParamId::flangerOffset) != 0.0 || p.getParam (ParamId::flangerSweep) != 0.0;
+
+        patch.flangerOffset = p.getParam (ParamId::flangerOffset) * p.getParam (ParamId::flangerOffset) * 1020.0f;
+        if (p.getParam (ParamId::flangerOffset) < 0.0)
+            patch.flangerOffset = -patch.flangerOffset;
+
+        patch.flangerDeltaOffset = p.getParam (ParamId::flangerSweep) * p.getParam (ParamId::flangerSweep) * p.getParam (ParamId::flangerSweep) * 0.2f;
+
+        if (p.getParam (ParamId::repeatSpeed) == 0.0)
+            patch.repeatLimit = 0;
+        else
+            patch.repeatLimit = int ((1.0f - p.getParam (ParamId::repeatSpeed)) * (1.0f - p.getParam (ParamId::repeatSpeed)) * 20000) + 32;
+
+        return patch;
+    }
+};
@@ -0,0 +1,217 @@
+/**
+ * SfxrProfile
+ *
+ * Copyright 2010 Thomas Vian
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * 	http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * @author Thomas Vian
+ */
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+
+#ifndef SFXR_PROFILE
+ #define SFXR_PROFILE 0
+#endif
+
+#if SFXR_PROFILE
+ #if defined (_MSC_VER) && (defined (_M_X64) || defined (_M_IX86))
+  #include <intrin.h>
+  #define SFXR_PROFILE_TSC 1
+ #elif defined (__x86_64__) || defined (__i386__)
+  #include <x86intrin.h>
+  #define SFXR_PROFILE_TSC 1
+ #endif
+#endif
+
+/**
+ * Time and invocation counters for each stage of the render loop
+ *
+ * Only compiled in when SFXR_PROFILE is defined to 1, otherwise the
+ * SFXR_PROFILE_ macros the kernels are marked up with expand to nothing and
+ * the counters stay at zero. Time is measured by laps: each mark reads the
+ * clock once and charges the time since the last mark to the stage that was
+ * running, so the stages add up to the time spent in the kernels. Reading
+ * the clock per sub-sample slows rendering a lot, compare the stages with
+ * each other rather than with uninstrumented timings.
+ */
+class SfxrProfile
+{
+public:
+    static constexpr bool enabled = SFXR_PROFILE != 0;
+
+    /** Stages of the render loop, in the order they run */
+    enum Stage
+    {
+        control,                              // Pitch, envelope and sweeps, counted per sample
+        oscillator,                           // Fundamental of the wave, per sub-sample
+        overtones,                            // Overtones after the fundamental, per overtone of each sub-sample on the scalar
+                                              // path, the SIMD and wavetable paths count them as oscillator
+        filters,                              // Low and high pass filters, per sub-sample
+        flanger,                              // Flanger, per sub-sample
+        decimation,                           // Sub-samples down to a sample, clipping and volume, per sample
+        bitCrush,                             // Bit crush sweep and sample and hold, per sample
+        compression,                          // std::pow compressor, per sample
+        output,                               // Mute and adding to the buffer, per sample
+        resample,                             // Resampler, per sample at the internal rate
+        format,                               // Conversion to the output format, per frame
+
+        numStages
+    };
+
+    struct Counter
+    {
+        uint64_t ticks = 0;                   // Clock ticks spent in the stage
+        uint64_t calls = 0;                   // Number of times the stage ran
+    };
+
+    //--------------------------------------------------------------------------
+    //
+    //  Marks
+    //
+    //--------------------------------------------------------------------------
+
+    /** Starts charging time to a stage */
+    void start (Stage stage)
+    {
+        _stage = stage;
+        _lapStart = now();
+    }
+
+    /** Charges the time since the last mark to the running stage and moves on to the next */
+    void lap (Stage stage)
+    {
+        uint64_t time = now();
+        _counters[size_t (_stage)].ticks += time - _lapStart;
+        _stage = stage;
+        _lapStart = time;
+    }
+
+    /** Charges the time since the last mark to the running stage and stops */
+    void stop()
+    {
+        _counters[size_t (_stage)].ticks += now() - _lapStart;
+    }
+
+    /** Adds invocations to a stage, counted per block rather than per mark */
+    void count (Stage stage, uint64_t calls)
+    {
+        _counters[size_t (stage)].calls += calls;
+    }
+
+    //--------------------------------------------------------------------------
+    //
+    //  Results
+    //
+    //--------------------------------------------------------------------------
+
+    const Counter& operator[] (Stage stage) const
+    {
+        return _counters[size_t (stage)];
+    }
+
+    /** Zeroes the counters */
+    void clear()
+    {
+        _counters.fill (Counter());
+    }
+
+    /** Adds the counters of another profile, to total several synths */
+    SfxrProfile& operator+= (const SfxrProfile& other)
+    {
+        for (size_t i = 0; i < _counters.size(); i++)
+        {
+            _counters[i].ticks += other._counters[i].ticks;
+            _counters[i].calls += other._counters[i].calls;
+        }
+        return *this;
+    }
+
+    /** Returns the sum of the ticks of all the stages */
+    uint64_t getTotalTicks() const
+    {
+        uint64_t total = 0;
+        for (const Counter& counter : _counters)
+            total += counter.ticks;
+        return total;
+    }
+
+    static const char* getStageName (Stage stage)
+    {
+        static const char* const names[numStages] = { "control", "oscillator", "overtones", "filters", "flanger", "decimation",
+                                                      "bitCrush", "compression", "output", "resample", "format" };
+        return names[size_t (stage)];
+    }
+
+    /** Returns what the ticks count, "tsc" for time stamp counter cycles or "ns" */
+    static const char* getClockName()
+    {
+       #if SFXR_PROFILE_TSC
+        return "tsc";
+       #else
+        return "ns";
+       #endif
+    }
+
+    /**
+     * Returns the counters as a JSON object
+     * {"clock": "tsc", "totalTicks": 1234, "stages": {"control": {"ticks": 100, "calls": 64}, ...}}
+     */
+    std::string toJson() const
+    {
+        char text[128];
+        std::snprintf (text, sizeof (text), "{\"clock\": \"%s\", \"totalTicks\": %llu, \"stages\": {", getClockName(), (unsigned long long) getTotalTicks());
+        std::string json = text;
+
+        for (int i = 0; i < numStages; i++)
+        {
+            std::snprintf (text, sizeof (text), "%s\"%s\": {\"ticks\": %llu, \"calls\": %llu}", i > 0 ? ", " : "", getStageName (Stage (i)),
+                           (unsigned long long) _counters[size_t (i)].ticks, (unsigned long long) _counters[size_t (i)].calls);
+            json += text;
+        }
+
+        return json + "}}";
+    }
+
+private:
+    static uint64_t now()
+    {
+       #if SFXR_PROFILE_TSC
+        return __rdtsc();
+       #else
+        return uint64_t (std::chrono::duration_cast<std::chrono::nanoseconds> (std::chrono::steady_clock::now().time_since_epoch()).count());
+       #endif
+    }
+
+    std::array<Counter, numStages> _counters {};
+    Stage _stage = control;
+    uint64_t _lapStart = 0;
+};
+
+/** Marks for the kernels, which expect a SfxrProfile called _profile */
+#if SFXR_PROFILE
+ #define SFXR_PROFILE_START(stage)          _profile.start (SfxrProfile::stage)
+ #define SFXR_PROFILE_LAP(stage)            _profile.lap (SfxrProfile::stage)
+ #define SFXR_PROFILE_STOP()                _profile.stop()
+ #define SFXR_PROFILE_COUNT(stage, calls)   _profile.count (SfxrProfile::stage, uint64_t (calls))
+#else
+ #define SFXR_PROFILE_START(stage)          ((void) 0)
+ #define SFXR_PROFILE_LAP(stage)            ((void) 0)
+ #define SFXR_PROFILE_STOP()                ((void) 0)
+ #define SFXR_PROFILE_COUNT(stage, calls)   ((void) 0)
+#endif
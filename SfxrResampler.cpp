@@ -0,0 +1,234 @@
+/**
+ * SfxrResampler
+ *
+ * Copyright 2010 Thomas Vian
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * @author Thomas Vian
+ */
+
+#include "SfxrResampler.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <map>
+#include <mutex>
+
+#include "SfxrOscillator.h"
+#include "Util.h"
+
+//--------------------------------------------------------------------------
+//
+//  Filter
+//
+//--------------------------------------------------------------------------
+
+/**
+ * One row of taps per phase, for an output sample that falls phase / numPhases
+ * of the way between two input samples. Deltas hold the difference to the
+ * next row, to interpolate between phases.
+ */
+struct SfxrResampler::Filter
+{
+    std::vector<float> coefficients;
+    std::vector<float> deltas;
+};
+
+/** Zeroth order modified Bessel function of the first kind, for the Kaiser window */
+static double besselI0 (double x)
+{
+    double sum = 1.0, term = 1.0;
+    for (int k = 1; k < 32; k++)
+    {
+        term *= (x / (2.0 * k)) * (x / (2.0 * k));
+        sum += term;
+    }
+    return sum;
+}
+
+/** Kaiser windowed sinc, cutoff is relative to the input Nyquist frequency */
+static double windowedSinc (double x, double cutoff)
+{
+    constexpr double beta = 7.0;
+    constexpr double halfWidth = SfxrResampler::numTaps / 2;
+
+    double r = x / halfWidth;
+    if (std::abs (r) >= 1.0)
+        return 0.0;
+
+    double sinc = x == 0.0 ? 1.0 : std::sin (pi * cutoff * x) / (pi * cutoff * x);
+    return cutoff * sinc * besselI0 (beta * std::sqrt (1.0 - r * r)) / besselI0 (beta);
+}
+
+std::shared_ptr<const SfxrResampler::Filter> SfxrResampler::getFilter (double cutoff)
+{
+    static std::mutex lock;
+    static std::map<double, std::weak_ptr<const Filter>> filters;
+
+    std::lock_guard<std::mutex> guard (lock);
+
+    if (auto filter = filters[cutoff].lock())
+        return filter;
+
+    // Each row is normalised to unity gain, so a constant input stays constant
+    std::vector<double> rows ((numPhases + 1) * numTaps);
+    for (int p = 0; p <= numPhases; p++)
+    {
+        double* row = &rows[size_t (p * numTaps)];
+        double sum = 0.0;
+
+        for (int j = 0; j < numTaps; j++)
+        {
+            row[j] = windowedSinc (j - numTaps / 2 + 1 - double (p) / numPhases, cutoff);
+            sum += row[j];
+        }
+
+        for (int j = 0; j < numTaps; j++)
+            row[j] /= sum;
+    }
+
+    auto filter = std::make_shared<Filter>();
+    filter->coefficients.resize (numPhases * numTaps);
+    filter->deltas.resize (numPhases * numTaps);
+
+    for (size_t i = 0; i < filter->coefficients.size(); i++)
+    {
+        filter->coefficients[i] = float (rows[i]);
+        filter->deltas[i] = float (rows[i + numTaps] - rows[i]);
+    }
+
+    filters[cutoff] = filter;
+    return filter;
+}
+
+//--------------------------------------------------------------------------
+//
+//  Stream
+//
+//--------------------------------------------------------------------------
+
+/** Input samples per output sample, 32.32 fixed point */
+static uint64_t getStep (double inputRate, double outputRate)
+{
+    return uint64_t (std::llround (inputRate / outputRate * 4294967296.0));
+}
+
+SfxrResampler::SfxrResampler (double inputRate, double outputRate)
+{
+    setRates (inputRate, outputRate);
+}
+
+void SfxrResampler::setRates (double inputRate, double outputRate)
+{
+    _inputRate = inputRate;
+    _outputRate = outputRate;
+    _step = getStep (inputRate, outputRate);
+
+    // Leaves a little room below Nyquist for the transition band
+    _filter = getFilter (0.9 * std::min (1.0, outputRate / inputRate));
+    _history.assign (size_t (maxWrite + 2 * numTaps), 0.0f);
+
+    reset();
+}
+
+void SfxrResampler::reset()
+{
+    // The taps before the first sample are silent
+    _count = numTaps / 2 - 1;
+    _position = uint64_t (_count) << 32;
+    std::fill (_history.begin(), _history.begin() + _count, 0.0f);
+}
+
+int SfxrResampler::write (const float* input, int count)
+{
+    // Drops the samples that no output sample still needs
+    int first = int (_position >> 32) - numTaps / 2 + 1;
+    if (first > 0)
+    {
+        first = std::min (first, _count);
+        std::memmove (_history.data(), _history.data() + first, size_t (_count - first) * sizeof (float));
+        _count -= first;
+        _position -= uint64_t (first) << 32;
+    }
+
+    count = std::min (count, int (_history.size()) - _count);
+    std::copy (input, input + count, _history.begin() + _count);
+    _count += count;
+
+    return count;
+}
+
+void SfxrResampler::flush()
+{
+    static const float silence[numTaps / 2] = {};
+    write (silence, numTaps / 2);
+}
+
+int SfxrResampler::getNumReady() const
+{
+    // An output sample needs the half of the taps after it
+    int available = _count - numTaps / 2;
+    if (available <= 0)
+        return 0;
+
+    uint64_t limit = uint64_t (available) << 32;
+    return _position < limit ? int ((limit - _position + _step - 1) / _step) : 0;
+}
+
+int SfxrResampler::read (float* output, int length)
+{
+    using Vec = SfxrOscillator::Vec;
+
+    length = std::min (length, getNumReady());
+
+    const float* coefficients = _filter->coefficients.data();
+    const float* deltas = _filter->deltas.data();
+
+    for (int n = 0; n < length; n++)
+    {
+        size_t index = size_t (_position >> 32);
+        uint32_t fraction = uint32_t (_position);
+
+        // The top bits pick the phase, the rest interpolate to the next one
+        size_t phase = fraction >> 24;
+        Vec blend = Vec::set (float (fraction & 0xffffff) * (1.0f / 16777216.0f));
+
+        const float* x = _history.data() + index - (numTaps / 2 - 1);
+        const float* h = coefficients + phase * numTaps;
+        const float* d = deltas + phase * numTaps;
+
+        Vec sum = Vec::set (0.0f);
+        for (int j = 0; j < numTaps; j += Vec::size)
+            sum = sum + Vec::load (x + j) * (Vec::load (h + j) + blend * Vec::load (d + j));
+
+        alignas (32) float lanes[Vec::size];
+        sum.store (lanes);
+
+        float sample = 0.0f;
+        for (int j = 0; j < Vec::size; j++)
+            sample += lanes[j];
+
+        output[n] += sample;
+        _position += _step;
+    }
+
+    return length;
+}
+
+size_t SfxrResampler::getOutputLength (size_t inputCount, double inputRate, double outputRate)
+{
+    uint64_t step = getStep (inputRate, outputRate);
+    return size_t (((uint64_t (inputCount) << 32) + step - 1) / step);
+}
@@ -0,0 +1,100 @@
+/**
+ * SfxrResampler
+ *
+ * Copyright 2010 Thomas Vian
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * @author Thomas Vian
+ */
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+/**
+ * Converts a stream of samples from one sample rate to another
+ *
+ * Each output sample is a 16 tap windowed sinc interpolated between 256
+ * precomputed phases, so any ratio works without drifting. The filter
+ * tables are shared by every resampler with the same cutoff and the dot
+ * products are vectorised with SfxrOscillator. Output is aligned with the
+ * input, with no added delay: the filter looks ahead by half its length,
+ * so the last few samples only come out once flush is called.
+ *
+ * Only setRates allocates, write and read can be used from an audio callback.
+ */
+class SfxrResampler
+{
+public:
+    static constexpr int numTaps = 16;        // Input samples per output sample
+    static constexpr int numPhases = 256;     // Filter phases between two input samples
+    static constexpr int maxWrite = 1024;     // Most samples a single write can take
+
+    SfxrResampler (double inputRate = 44100.0, double outputRate = 44100.0);
+
+    /**
+     * Sets the rates and resets the stream
+     * Downsampling lowers the cutoff to the new Nyquist frequency
+     */
+    void setRates (double inputRate, double outputRate);
+
+    double getInputRate() const     { return _inputRate; }
+    double getOutputRate() const    { return _outputRate; }
+
+    /** Clears the stream, the next sample written is the first */
+    void reset();
+
+    /**
+     * Adds input samples to the stream
+     * Output has to be read out before more than maxWrite samples are pending
+     * @param	input		Samples at the input rate
+     * @param	count		Number of samples
+     * @return				Number of samples taken, less than count when the buffer is full
+     */
+    int write (const float* input, int count);
+
+    /** Pads the end of the input with silence, so every output sample of it can be read */
+    void flush();
+
+    /**
+     * Adds the output samples that are ready to the buffer
+     * @param	output		Buffer to add to
+     * @param	length		Most samples wanted
+     * @return				Number of samples added
+     */
+    int read (float* output, int length);
+
+    /** Number of output samples that can be read before more input is needed */
+    int getNumReady() const;
+
+    /** Number of output samples that inputCount input samples turn into, from the start of a stream */
+    static size_t getOutputLength (size_t inputCount, double inputRate, double outputRate);
+
+private:
+    struct Filter;
+
+    /** Returns the filter for a cutoff, building it the first time */
+    static std::shared_ptr<const Filter> getFilter (double cutoff);
+
+    double _inputRate = 44100.0;
+    double _outputRate = 44100.0;
+
+    uint64_t _step = 0;                       // Input samples per output sample, 32.32 fixed point
+    uint64_t _position = 0;                   // Position of the next output sample in _history, 32.32 fixed point
+    int _count = 0;                           // Samples held in _history
+
+    std::shared_ptr<const Filter> _filter;
+    std::vector<float> _history;              // Input not yet used, preceded by the taps before it
+};
@@ -0,0 +1,298 @@
+/**
+ * SfxrSearch
+ *
+ * Copyright 2010 Thomas Vian
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * @author Thomas Vian
+ */
+
+#include "SfxrSearch.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+
+#include "SfxrAnalysis.h"
+
+SfxrSearch::SfxrSearch (Fitness fitness, const Settings& settings, unsigned int numThreads)
+    : _fitness (std::move (fitness)),
+      _settings (settings),
+      _synth (settings.sampleRate),
+      _batch (numThreads)
+{
+    _settings.populationSize = std::max (_settings.populationSize, size_t (1));
+    _settings.eliteCount = std::min (_settings.eliteCount, _settings.populationSize);
+    _settings.tournamentSize = std::max (_settings.tournamentSize, size_t (1));
+
+    _synth.setSeed (_settings.renderSeed);
+    _synth.setFinishOnSilence (true);
+    _synth.setSilenceThreshold (_settings.silenceThreshold);
+    _synth.setFastMath (_settings.fastMath);
+}
+
+//--------------------------------------------------------------------------
+//
+//  Search Methods
+//
+//--------------------------------------------------------------------------
+
+void SfxrSearch::start (const SfxrParams& origin)
+{
+    _random.setSeed (_seed);
+    _stats = Stats();
+
+    _population.assign (_settings.populationSize, Candidate());
+    _population[0].params = origin;
+
+    for (size_t i = 1; i < _population.size(); i++)
+    {
+        SfxrParams& params = _population[i].params;
+        params = origin;
+
+        if (float (_random.uniform()) < _settings.randomRate)
+            params.randomize (_random);
+        else
+            params.mutate (_random, _settings.mutation);
+    }
+
+    evaluatePopulation (0);
+}
+
+void SfxrSearch::step()
+{
+    if (_population.empty())
+        return;
+
+    // Elites stay at the front with their scores, only the children are rendered
+    _children.assign (_population.begin(), _population.begin() + std::ptrdiff_t (_settings.eliteCount));
+
+    while (_children.size() < _settings.populationSize)
+    {
+        Candidate child;
+        child.params = pickParent().params;
+
+        if (float (_random.uniform()) < _settings.crossoverRate)
+            child.params.crossover (pickParent().params, _random);
+
+        if (float (_random.uniform()) < _settings.randomRate)
+            child.params.randomize (_random);
+        else
+            child.params.mutate (_random, _settings.mutation);
+
+        _children.push_back (child);
+    }
+
+    _population.swap (_children);
+    evaluatePopulation (_settings.eliteCount);
+}
+
+void SfxrSearch::run (uint64_t generations, float targetFitness)
+{
+    for (uint64_t i = 0; i < generations && ! _population.empty() && getBest().fitness < targetFitness; i++)
+        step();
+}
+
+SfxrSearch::Candidate SfxrSearch::evaluate (const SfxrParams& params) const
+{
+    Candidate candidate;
+    candidate.params = params;
+
+    uint64_t samplesRendered = 0;
+    evaluate (candidate, samplesRendered);
+    return candidate;
+}
+
+void SfxrSearch::evaluatePopulation (size_t first)
+{
+    std::vector<size_t> lengths (_population.size() - first);
+    for (size_t i = 0; i < lengths.size(); i++)
+    {
+        lengths[i] = SfxrBatch::getMaxSampleCount (_population[first + i].params, _settings.sampleRate);
+        if (_settings.maxSamples != 0)
+            lengths[i] = std::min (lengths[i], _settings.maxSamples);
+    }
+
+    std::atomic<uint64_t> samplesRendered (0);
+
+    _batch.run (lengths, [&] (size_t index)
+    {
+        uint64_t rendered = 0;
+        evaluate (_population[first + index], rendered);
+        samplesRendered += rendered;
+    });
+
+    for (size_t i = first; i < _population.size(); i++)
+        _stats.rejected += _population[i].rejected ? 1 : 0;
+
+    _stats.evaluated += lengths.size();
+    _stats.samplesRendered += samplesRendered;
+    _stats.generations++;
+
+    sort();
+}
+
+void SfxrSearch::evaluate (Candidate& candidate, uint64_t& samplesRendered) const
+{
+    SfxrSynth synth (_synth);
+    synth.setParams (candidate.params);
+
+    const size_t length = synth.getSampleCount();
+    const size_t wanted = _settings.maxSamples != 0 ? std::min (length, _settings.maxSamples) : length;
+
+    std::vector<float> buffer (wanted, 0.0f);
+    synth.reset (true);
+
+    // The preview sees the start of the sound, and the rest is only rendered if it passes
+    size_t rendered = 0;
+    if (_preview)
+    {
+        const size_t previewLength = std::min (_settings.previewSamples, wanted);
+        rendered = size_t (synth.render (buffer.data(), int (previewLength)));
+
+        Render preview;
+        preview.samples = buffer.data();
+        preview.numSamples = rendered;
+        preview.length = rendered < previewLength ? rendered : length;
+        preview.sampleRate = _settings.sampleRate;
+
+        if (! _preview (preview))
+        {
+            samplesRendered += rendered;
+            candidate.fitness = -std::numeric_limits<float>::infinity();
+            candidate.rejected = true;
+            return;
+        }
+    }
+
+    rendered += size_t (synth.render (buffer.data() + rendered, int (wanted - rendered)));
+    samplesRendered += rendered;
+
+    Render render;
+    render.samples = buffer.data();
+    render.numSamples = rendered;
+    render.length = rendered < wanted ? rendered : length;
+    render.sampleRate = _settings.sampleRate;
+
+    const float fitness = _fitness (render);
+    candidate.fitness = std::isnan (fitness) ? -std::numeric_limits<float>::infinity() : fitness;
+    candidate.rejected = false;
+}
+
+const SfxrSearch::Candidate& SfxrSearch::pickParent()
+{
+    // The population is sorted, so the lowest index drawn is the fittest
+    size_t best = _population.size();
+    for (size_t i = 0; i < _settings.tournamentSize; i++)
+        best = std::min (best, size_t (_random.nextInt() % _population.size()));
+
+    return _population[best];
+}
+
+void SfxrSearch::sort()
+{
+    std::stable_sort (_population.begin(), _population.end(), [] (const Candidate& a, const Candidate& b)
+    {
+        return a.fitness > b.fitness;
+    });
+}
+
+//--------------------------------------------------------------------------
+//
+//  Fitness Functions
+//
+//--------------------------------------------------------------------------
+
+SfxrSearch::Fitness SfxrSearch::targetDuration (float seconds)
+{
+    return [seconds] (const Render& render)
+    {
+        const double duration = double (std::max (render.length, size_t (1))) / render.sampleRate;
+        return -float (std::abs (std::log2 (duration / seconds)));
+    };
+}
+
+SfxrSearch::Fitness SfxrSearch::targetLoudness (float decibels)
+{
+    return [decibels] (const Render& render)
+    {
+        const double rms = SfxrAnalysis::getRms (render.samples, render.numSamples);
+        const double level = 20.0 * std::log10 (std::max (rms, 1.0e-10));
+        return -float (std::abs (level - decibels) / 6.0);
+    };
+}
+
+SfxrSearch::Fitness SfxrSearch::targetCentroid (float hertz)
+{
+    return [hertz] (const Render& render)
+    {
+        const auto spectrum = SfxrAnalysis::getSpectrum (render.samples, render.numSamples, render.numSamples);
+        const double centroid = std::max (spectrum.centroid * render.sampleRate, 1.0);
+        return -float (std::abs (std::log2 (centroid / hertz)));
+    };
+}
+
+/** Share of the energy in each band, in dB, no lower than floor dB below the loudest band */
+static std::array<double, SfxrAnalysis::numBands> getShape (const float* samples, size_t numSamples, double floor)
+{
+    auto bands = SfxrAnalysis::getSpectrum (samples, numSamples, numSamples).bands;
+
+    double total = 0.0, loudest = 0.0;
+    for (double energy : bands)
+    {
+        total += energy;
+        loudest = std::max (loudest, energy);
+    }
+
+    if (total <= 0.0)
+    {
+        bands.fill (-floor);
+        return bands;
+    }
+
+    const double minimum = loudest / total * std::pow (10.0, -floor / 10.0);
+    for (double& energy : bands)
+        energy = 10.0 * std::log10 (std::max (energy / total, minimum));
+
+    return bands;
+}
+
+SfxrSearch::Fitness SfxrSearch::matchReference (const std::vector<float>& reference)
+{
+    constexpr double floor = 60.0;
+    const auto target = getShape (reference.data(), reference.size(), floor);
+    const double lowest = *std::min_element (target.begin(), target.end());
+
+    return [target, lowest] (const Render& render)
+    {
+        const auto shape = getShape (render.samples, render.numSamples, floor);
+
+        double difference = 0.0;
+        for (size_t i = 0; i < target.size(); i++)
+            difference += std::abs (std::max (shape[i], lowest) - target[i]);
+
+        return -float (difference / double (target.size()) / 6.0);
+    };
+}
+
+SfxrSearch::Preview SfxrSearch::rejectQuiet (float decibels)
+{
+    const float level = std::pow (10.0f, decibels / 20.0f);
+
+    return [level] (const Render& preview)
+    {
+        return std::any_of (preview.samples, preview.samples + preview.numSamples,
+                            [level] (float sample) { return std::abs (sample) >= level; });
+    };
+}
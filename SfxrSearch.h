@@ -0,0 +1,225 @@
+/**
+ * SfxrSearch
+ *
+ * Copyright 2010 Thomas Vian
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * 	http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * @author Thomas Vian
+ */
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <vector>
+
+#include "SfxrBatch.h"
+#include "SfxrParams.h"
+#include "SfxrSynth.h"
+
+/**
+ * Evolves a population of patches towards a fitness function measured on their renders
+ *
+ * Each generation keeps the best few candidates and breeds the rest from
+ * parents picked by tournament: a child mixes two parents with
+ * SfxrParams::crossover or copies one, then is mutated or, now and then,
+ * randomized. Locked params are left alone throughout, so every candidate
+ * keeps the locked values of the patch the search started from.
+ *
+ * Children are rendered and scored in parallel on an SfxrBatch pool. Each
+ * render finishes on silence and can be cut short after a number of samples, and an
+ * optional preview looks at the first samples and rejects hopeless
+ * candidates before the rest is rendered. Breeding runs on the calling
+ * thread from the search's own seed, so a search always takes the same path
+ * however many threads it has.
+ */
+class SfxrSearch
+{
+public:
+    /** A rendered candidate, as handed to the fitness and preview functions */
+    struct Render
+    {
+        const float* samples = nullptr;
+        size_t numSamples = 0;                // Samples rendered
+        size_t length = 0;                    // Samples the sound lasts, more than numSamples if the render was cut short
+        float sampleRate = 44100.0f;
+    };
+
+    /** Scores a render, higher is better, called from several threads at once */
+    typedef std::function<float (const Render& render)> Fitness;
+
+    /** Looks at the start of a render, returning false rejects the candidate, called from several threads at once */
+    typedef std::function<bool (const Render& preview)> Preview;
+
+    struct Settings
+    {
+        size_t populationSize = 64;
+        size_t eliteCount = 4;                // Best candidates carried over unchanged
+        size_t tournamentSize = 3;            // Candidates compared to pick each parent
+        float crossoverRate = 0.7f;           // Chance a child mixes two parents rather than copying one
+        float mutation = 0.05f;               // Amount passed to SfxrParams::mutate
+        float randomRate = 0.05f;             // Chance a child is randomized rather than mutated
+        size_t previewSamples = 4096;         // Samples rendered before the preview is asked
+        size_t maxSamples = 0;                // Most samples rendered per candidate, 0 for whole sounds
+        float sampleRate = 44100.0f;
+        float silenceThreshold = 1.0e-4f;     // Renders finish once they fall below this, see SfxrSynth::setFinishOnSilence
+        uint64_t renderSeed = 1;              // Noise seed of every render, so a candidate always scores the same
+        bool fastMath = true;                 // Renders with SfxrSynth::setFastMath, close enough to score by and several times faster for some waves
+    };
+
+    struct Candidate
+    {
+        SfxrParams params;
+        float fitness = -std::numeric_limits<float>::infinity();
+        bool rejected = false;                // If the preview rejected it
+    };
+
+    struct Stats
+    {
+        uint64_t generations = 0;
+        uint64_t evaluated = 0;               // Candidates scored or rejected
+        uint64_t rejected = 0;                // Candidates rejected by the preview
+        uint64_t samplesRendered = 0;
+    };
+
+    /**
+     * @param	fitness		Function the search maximises
+     * @param	settings	Population and render settings
+     * @param	numThreads	Threads to evaluate on, including the calling thread, 0 for one per core
+     */
+    SfxrSearch (Fitness fitness, const Settings& settings, unsigned int numThreads = 0);
+
+    explicit SfxrSearch (Fitness fitness)
+        : SfxrSearch (std::move (fitness), Settings())
+    {
+    }
+
+    SfxrSearch (const SfxrSearch&) = delete;
+    SfxrSearch& operator= (const SfxrSearch&) = delete;
+
+    //--------------------------------------------------------------------------
+    //
+    //  Getters / Setters
+    //
+    //--------------------------------------------------------------------------
+
+    /** Sets the function that rejects candidates from the start of their render, null for none */
+    void setPreview (Preview preview)
+    {
+        _preview = std::move (preview);
+    }
+
+    /** Sets the seed breeding draws from, takes effect on the next start */
+    void setSeed (uint64_t seed)
+    {
+        _seed = seed;
+    }
+
+    const Settings& getSettings() const
+    {
+        return _settings;
+    }
+
+    /** Candidates of the last generation, best first */
+    const std::vector<Candidate>& getPopulation() const
+    {
+        return _population;
+    }
+
+    /** Best candidate of the last generation */
+    const Candidate& getBest() const
+    {
+        return _population.front();
+    }
+
+    const Stats& getStats() const
+    {
+        return _stats;
+    }
+
+    //--------------------------------------------------------------------------
+    //
+    //  Search Methods
+    //
+    //--------------------------------------------------------------------------
+
+    /**
+     * Starts a search from a patch and scores the first generation
+     * The population is the patch itself and mutations of it, or random
+     * patches for randomRate of them. The patch's locks hold for the whole search.
+     */
+    void start (const SfxrParams& origin);
+
+    /** Breeds and scores the next generation */
+    void step();
+
+    /** Runs generations until there have been a number of them or the best is at least a fitness */
+    void run (uint64_t generations, float targetFitness = std::numeric_limits<float>::infinity());
+
+    /** Renders and scores one candidate on the calling thread */
+    Candidate evaluate (const SfxrParams& params) const;
+
+    //--------------------------------------------------------------------------
+    //
+    //  Fitness Functions
+    //
+    //  Each scores 0 for a perfect match and falls by 1 each time the sound
+    //  is off by a factor of 2, so they can be added together.
+    //
+    //--------------------------------------------------------------------------
+
+    /** Scores how close the sound lasts to a number of seconds, in doublings */
+    static Fitness targetDuration (float seconds);
+
+    /** Scores how close the RMS level is to a level in dBFS, in 6 dB steps */
+    static Fitness targetLoudness (float decibels);
+
+    /** Scores how close the spectral centroid is to a frequency, in octaves */
+    static Fitness targetCentroid (float hertz);
+
+    /**
+     * Scores how close the sound's spectrum is to a reference sound's, as the
+     * mean difference of the SfxrAnalysis bands in 6 dB steps
+     * @param	reference	Samples of the reference, at the search's sample rate
+     */
+    static Fitness matchReference (const std::vector<float>& reference);
+
+    /** Rejects previews whose loudest sample is below a level in dBFS */
+    static Preview rejectQuiet (float decibels = -60.0f);
+
+private:
+    /** Scores the candidates from first on, in parallel, then sorts the population */
+    void evaluatePopulation (size_t first);
+
+    /** Evaluates a candidate, adding to the rendered samples */
+    void evaluate (Candidate& candidate, uint64_t& samplesRendered) const;
+
+    /** Picks a parent, the best of tournamentSize random candidates */
+    const Candidate& pickParent();
+
+    /** Sorts the population best first */
+    void sort();
+
+    Fitness _fitness;
+    Preview _preview;
+    Settings _settings;
+    SfxrSynth _synth;                         // Set up for the settings and copied for each render, which also keeps its resampler filter alive
+    SfxrBatch _batch;
+
+    uint64_t _seed = 1;
+    SfxrRandom _random;
+    std::vector<Candidate> _population;
+    std::vector<Candidate> _children;
+    Stats _stats;
+};
@@ -0,0 +1,329 @@
+/**
+ * SfxrSerialization
+ *
+ * Copyright 2010 Thomas Vian
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * @author Thomas Vian
+ */
+
+#include "SfxrSerialization.h"
+
+#include <charconv>
+#include <cmath>
+#include <cstring>
+
+static const char libraryMagic[4] = { 'B', 'F', 'X', 'P' };
+
+//--------------------------------------------------------------------------
+//
+//  Bytes
+//
+//--------------------------------------------------------------------------
+
+static uint8_t* put16 (uint8_t* out, uint16_t value)
+{
+    out[0] = uint8_t (value);
+    out[1] = uint8_t (value >> 8);
+    return out + 2;
+}
+
+static uint8_t* put32 (uint8_t* out, uint32_t value)
+{
+    out[0] = uint8_t (value);
+    out[1] = uint8_t (value >> 8);
+    out[2] = uint8_t (value >> 16);
+    out[3] = uint8_t (value >> 24);
+    return out + 4;
+}
+
+static uint16_t get16 (const uint8_t* in)
+{
+    return uint16_t (in[0] | in[1] << 8);
+}
+
+static uint32_t get32 (const uint8_t* in)
+{
+    return uint32_t (in[0]) | uint32_t (in[1]) << 8 | uint32_t (in[2]) << 16 | uint32_t (in[3]) << 24;
+}
+
+//--------------------------------------------------------------------------
+//
+//  Quantization
+//
+//  Each value is stored as a step of its range. The steps are picked so the
+//  values that switch stages on and off come back exactly: the ends of every
+//  range, and 0 in the middle of the -1 to 1 ranges. The wave type is stored
+//  as the whole number the synth truncates it to.
+//
+//--------------------------------------------------------------------------
+
+static float getSteps (size_t param)
+{
+    const Param& info = SfxrParams::schema[param];
+
+    if (ParamId (param) == ParamId::waveType)
+        return info.maxValue - info.minValue;
+
+    return info.minValue == -info.maxValue ? 65534.0f : 65535.0f;
+}
+
+static uint16_t quantize (size_t param, float value)
+{
+    const Param& info = SfxrParams::schema[param];
+    const float position = (value - info.minValue) / (info.maxValue - info.minValue) * getSteps (param);
+
+    if (ParamId (param) == ParamId::waveType)
+        return uint16_t (position);
+
+    return uint16_t (position + 0.5f);
+}
+
+static float unquantize (size_t param, uint16_t step)
+{
+    const Param& info = SfxrParams::schema[param];
+    return info.minValue + (info.maxValue - info.minValue) * (float (step) / getSteps (param));
+}
+
+//--------------------------------------------------------------------------
+//
+//  Binary
+//
+//--------------------------------------------------------------------------
+
+size_t SfxrSerialization::getRecordSize (Encoding encoding)
+{
+    return 4 + SfxrParams::numParams * (encoding == quantized16 ? 2 : 4);
+}
+
+size_t SfxrSerialization::getEncodedSize (size_t count, Encoding encoding)
+{
+    return headerSize + count * getRecordSize (encoding);
+}
+
+size_t SfxrSerialization::encode (const SfxrParams* params, size_t count, Encoding encoding, uint8_t* out, size_t capacity)
+{
+    const size_t size = getEncodedSize (count, encoding);
+    if (capacity < size || count > UINT32_MAX)
+        return 0;
+
+    std::memcpy (out, libraryMagic, 4);
+    out = put16 (out + 4, version);
+    out = put16 (out, encoding);
+    out = put32 (out, uint32_t (count));
+
+    for (size_t i = 0; i < count; i++)
+    {
+        const SfxrParams& p = params[i];
+        out = put32 (out, p.getLockedMask());
+
+        for (size_t j = 0; j < SfxrParams::numParams; j++)
+        {
+            const float value = p.getParam (ParamId (j));
+
+            if (encoding == quantized16)
+            {
+                out = put16 (out, quantize (j, value));
+            }
+            else
+            {
+                uint32_t bits;
+                std::memcpy (&bits, &value, 4);
+                out = put32 (out, bits);
+            }
+        }
+    }
+
+    return size;
+}
+
+bool SfxrSerialization::readHeader (const uint8_t* data, size_t size, size_t& count, Encoding& encoding)
+{
+    if (size < headerSize || std::memcmp (data, libraryMagic, 4) != 0 || get16 (data + 4) != version)
+        return false;
+
+    const uint16_t storedEncoding = get16 (data + 6);
+    if (storedEncoding != float32 && storedEncoding != quantized16)
+        return false;
+
+    encoding = Encoding (storedEncoding);
+    count = get32 (data + 8);
+    return true;
+}
+
+size_t SfxrSerialization::decode (const uint8_t* data, size_t size, SfxrParams* out, size_t capacity)
+{
+    size_t count;
+    Encoding encoding;
+    if (! readHeader (data, size, count, encoding) || (size - headerSize) / getRecordSize (encoding) < count)
+        return 0;
+
+    count = std::min (count, capacity);
+    data += headerSize;
+
+    for (size_t i = 0; i < count; i++)
+    {
+        SfxrParams& p = out[i];
+        p.setLockedMask (get32 (data));
+        data += 4;
+
+        for (size_t j = 0; j < SfxrParams::numParams; j++)
+        {
+            float value;
+
+            if (encoding == quantized16)
+            {
+                value = unquantize (j, get16 (data));
+                data += 2;
+            }
+            else
+            {
+                const uint32_t bits = get32 (data);
+                std::memcpy (&value, &bits, 4);
+                data += 4;
+
+                if (std::isnan (value))
+                    value = SfxrParams::getDefault (ParamId (j));
+            }
+
+            p.setParam (ParamId (j), value);
+        }
+    }
+
+    return count;
+}
+
+//--------------------------------------------------------------------------
+//
+//  Bfxr Strings
+//
+//--------------------------------------------------------------------------
+
+size_t SfxrSerialization::writeString (const SfxrParams& params, char* out, size_t capacity)
+{
+    char* const start = out;
+    char* const end = out + capacity;
+
+    for (size_t i = 0; i < SfxrParams::numParams; i++)
+    {
+        if (i > 0)
+        {
+            if (out == end)
+                return 0;
+            *out++ = ',';
+        }
+
+        auto result = std::to_chars (out, end, params.getParam (ParamId (i)));
+        if (result.ec != std::errc())
+            return 0;
+
+        out = result.ptr;
+    }
+
+    return size_t (out - start);
+}
+
+std::string SfxrSerialization::toString (const SfxrParams& params)
+{
+    char text[maxStringLength];
+    return std::string (text, writeString (params, text, sizeof (text)));
+}
+
+bool SfxrSerialization::readString (std::string_view text, SfxrParams& params)
+{
+    float values[SfxrParams::numParams];
+    size_t count = 0;
+
+    const char* position = text.data();
+    const char* const end = text.data() + text.size();
+
+    while (true)
+    {
+        while (position != end && (*position == ' ' || *position == '\t'))
+            position++;
+
+        if (count == SfxrParams::numParams)
+            return false;
+
+        // from_chars doesn't take the leading + some writers put on positive numbers
+        if (position != end && *position == '+')
+            position++;
+
+        auto result = std::from_chars (position, end, values[count]);
+        if (result.ec != std::errc() || std::isnan (values[count]))
+            return false;
+
+        count++;
+        position = result.ptr;
+
+        while (position != end && (*position == ' ' || *position == '\t' || *position == '\r'))
+            position++;
+
+        if (position == end)
+            break;
+
+        if (*position++ != ',')
+            return false;
+    }
+
+    for (size_t i = 0; i < SfxrParams::numParams; i++)
+        params.setParam (ParamId (i), i < count ? values[i] : SfxrParams::getDefault (ParamId (i)));
+
+    return true;
+}
+
+size_t SfxrSerialization::writeStrings (const SfxrParams* params, size_t count, char* out, size_t capacity)
+{
+    size_t length = 0;
+
+    for (size_t i = 0; i < count; i++)
+    {
+        size_t written = writeString (params[i], out + length, capacity - length);
+        if (written == 0 || length + written == capacity)
+            return 0;
+
+        length += written;
+        out[length++] = '\n';
+    }
+
+    return length;
+}
+
+size_t SfxrSerialization::readStrings (std::string_view text, SfxrParams* out, size_t capacity, size_t* consumed)
+{
+    size_t count = 0, position = 0;
+
+    while (position < text.size() && count < capacity)
+    {
+        size_t lineEnd = text.find ('\n', position);
+        if (lineEnd == std::string_view::npos)
+            lineEnd = text.size();
+
+        std::string_view line = text.substr (position, lineEnd - position);
+        if (line.find_first_not_of (" \t\r") != std::string_view::npos)
+        {
+            if (! readString (line, out[count]))
+                break;
+
+            count++;
+        }
+
+        position = std::min (lineEnd + 1, text.size());
+    }
+
+    if (consumed != nullptr)
+        *consumed = position;
+
+    return count;
+}
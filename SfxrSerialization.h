@@ -0,0 +1,140 @@
+/**
+ * SfxrSerialization
+ *
+ * Copyright 2010 Thomas Vian
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * 	http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * @author Thomas Vian
+ */
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+#include "SfxrParams.h"
+
+/**
+ * Saves and loads SfxrParams, one at a time or whole libraries at once
+ *
+ * The binary form is a 12 byte header, "BFXP", a 16 bit version, a 16 bit
+ * encoding and a 32 bit patch count, followed by one record per patch: a
+ * 32 bit lock mask and the values in ParamId order, either as floats or
+ * quantized to 16 bits. Everything is little endian.
+ *
+ * The string form is the one Bfxr copies to the clipboard, the values in
+ * ParamId order separated by commas. Libraries of strings have one per line.
+ *
+ * None of the bulk functions allocate, they work on caller owned arrays of
+ * params and buffers of bytes or characters.
+ */
+namespace SfxrSerialization
+{
+    //--------------------------------------------------------------------------
+    //
+    //  Binary
+    //
+    //--------------------------------------------------------------------------
+
+    enum Encoding : uint16_t
+    {
+        float32,                              // Exact, 132 bytes a patch
+        quantized16                           // 68 bytes a patch, each value within 1 / 65534 of its range
+    };
+
+    static constexpr uint16_t version = 1;
+    static constexpr size_t headerSize = 12;
+
+    /** Returns the bytes of one patch record */
+    size_t getRecordSize (Encoding encoding);
+
+    /** Returns the bytes needed to encode a number of patches, header included */
+    size_t getEncodedSize (size_t count, Encoding encoding);
+
+    /**
+     * Encodes patches to a buffer
+     * @param	params		Patches to write
+     * @param	count		Number of patches
+     * @param	encoding	How the values are stored
+     * @param	out			Buffer to write to
+     * @param	capacity	Size of the buffer, at least getEncodedSize (count, encoding)
+     * @return				Number of bytes written, 0 if the buffer is too small
+     */
+    size_t encode (const SfxrParams* params, size_t count, Encoding encoding, uint8_t* out, size_t capacity);
+
+    /**
+     * Reads the header of an encoded library
+     * @return				False if it isn't a library this version can read
+     */
+    bool readHeader (const uint8_t* data, size_t size, size_t& count, Encoding& encoding);
+
+    /**
+     * Decodes an encoded library into an array of params
+     * Values are clamped to their ranges and the locks are restored, the rest
+     * of each SfxrParams is left as it was
+     * @param	data		Encoded library
+     * @param	size		Size of the library in bytes
+     * @param	out			Params to decode into
+     * @param	capacity	Number of params in out
+     * @return				Number of patches decoded, the count in the header unless
+     *						out is too small, 0 if the data is damaged or truncated
+     */
+    size_t decode (const uint8_t* data, size_t size, SfxrParams* out, size_t capacity);
+
+    //--------------------------------------------------------------------------
+    //
+    //  Bfxr Strings
+    //
+    //--------------------------------------------------------------------------
+
+    /** Longest BFXR string writeString can produce */
+    static constexpr size_t maxStringLength = SfxrParams::numParams * 16;
+
+    /**
+     * Writes the values of params as a BFXR string, without a terminating zero
+     * Each value is written with the fewest digits that read back exactly
+     * @return				Length of the string, 0 if capacity is too small
+     */
+    size_t writeString (const SfxrParams& params, char* out, size_t capacity);
+
+    /** Returns the values of params as a BFXR string */
+    std::string toString (const SfxrParams& params);
+
+    /**
+     * Sets the values of params from a BFXR string
+     * Strings from older versions with fewer values leave the params they
+     * don't have at their defaults. Locks are left as they were.
+     * @return				False if the string has too many values or one isn't a number,
+     *						in which case params is unchanged
+     */
+    bool readString (std::string_view text, SfxrParams& params);
+
+    /**
+     * Writes patches as BFXR strings, one per line
+     * @return				Number of characters written, 0 if capacity is too small
+     */
+    size_t writeStrings (const SfxrParams* params, size_t count, char* out, size_t capacity);
+
+    /**
+     * Reads BFXR strings, one per line, blank lines are skipped
+     * Stops at the first line that isn't a BFXR string or when out is full
+     * @param	text		Lines to read
+     * @param	out			Params to read into
+     * @param	capacity	Number of params in out
+     * @param	consumed	If not null, set to the number of characters read
+     * @return				Number of patches read
+     */
+    size_t readStrings (std::string_view text, SfxrParams* out, size_t capacity, size_t* consumed = nullptr);
+}
@@ -0,0 +1,607 @@
+/**
+ * SfxrSynth
+ *
+ * Copyright 2010 Thomas Vian
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * @author Thomas Vian
+ */
+
+#include "SfxrSynth.h"
+
+#include <array>
+#include <utility>
+
+//--------------------------------------------------------------------------
+//
+//  Kernel Tables
+//
+//--------------------------------------------------------------------------
+
+struct SfxrSynthKernels
+{
+    static constexpr unsigned int waveTypes = 9;
+
+    template <size_t... I>
+    static constexpr std::array<SfxrSynth::ControlKernel, sizeof... (I)> makeControlTable (std::index_sequence<I...>)
+    {
+        return {{ &SfxrSynth::synthControl<(I & 1) != 0, (I & 2) != 0, (I & 4) != 0, (I & 8) != 0, (I & 16) != 0, (I & 32) != 0, (I & 64) != 0>... }};
+    }
+
+    template <size_t... I>
+    static constexpr std::array<SfxrSynth::OscillatorKernel, sizeof... (I)> makeOscillatorTable (std::index_sequence<I...>)
+    {
+        return {{ &SfxrSynth::synthOscillator<unsigned (I / 16), (I & 1) != 0, (I & 2) != 0, oscillatorPath (unsigned (I / 16), int (I % 16) / 4)>... }};
+    }
+
+    /** The SIMD path falls back to scalar for wave types without a vector path */
+    static constexpr int oscillatorPath (unsigned int waveType, int path)
+    {
+        return path == SfxrSynth::oscillatorSimd && ! SfxrOscillator::isVectorised (waveType) ? SfxrSynth::oscillatorScalar : path;
+    }
+
+    template <size_t... I>
+    static constexpr std::array<SfxrSynth::OutputKernel, sizeof... (I)> makeOutputTable (std::index_sequence<I...>)
+    {
+        return {{ &SfxrSynth::synthOutput<(I & 1) != 0, (I & 2) != 0, (I & 4) != 0>... }};
+    }
+};
+
+static constexpr auto controlKernels = SfxrSynthKernels::makeControlTable (std::make_index_sequence<128>());
+static constexpr auto oscillatorKernels = SfxrSynthKernels::makeOscillatorTable (std::make_index_sequence<SfxrSynthKernels::waveTypes * 16>());
+static constexpr auto outputKernels = SfxrSynthKernels::makeOutputTable (std::make_index_sequence<8>());
+
+void SfxrSynth::selectKernels (unsigned int waveType, unsigned int features, int oscillatorPath, bool fastMath)
+{
+    auto has = [features] (unsigned int feature) { return (features & feature) != 0 ? 1u : 0u; };
+    const unsigned int fast = fastMath ? 1u : 0u;
+
+    if (waveType >= SfxrSynthKernels::waveTypes)
+        waveType = SfxrSynthKernels::waveTypes - 1;
+
+    _controlKernel = controlKernels[has (featureFilters) | has (featureFlanger) << 1 | has (featureVibrato) << 2
+                                    | has (featureRepeat) << 3 | has (featurePitchChange) << 4 | has (featureDutySweep) << 5 | fast << 6];
+    _oscillatorKernel = oscillatorKernels[waveType * 16 + unsigned (oscillatorPath) * 4 + (has (featureFilters) | has (featureFlanger) << 1)];
+    _outputKernel = outputKernels[has (featureBitCrush) | has (featureCompression) << 1 | fast << 2];
+}
+
+unsigned int SfxrSynth::getActiveFeatures (const SfxrPatch& p)
+{
+    unsigned int features = 0;
+
+    if (p.filters)                                          features |= featureFilters;
+    if (p.flanger)                                          features |= featureFlanger;
+    if (p.vibratoAmplitude > 0.0)                           features |= featureVibrato;
+    if (p.repeatLimit != 0)                                 features |= featureRepeat;
+    if (p.changeAmount != 1.0f || p.changeAmount2 != 1.0f)  features |= featurePitchChange;
+    if (p.waveType == 0 && p.dutySweep != 0.0f)             features |= featureDutySweep;
+    if (p.bitcrushFreq != 1.0f || p.bitcrushFreqSweep != 0) features |= featureBitCrush;
+    if (p.compressionFactor != 1.0f)                        features |= featureCompression;
+
+    return features;
+}
+
+//--------------------------------------------------------------------------
+//
+//  Kernels
+//
+//  Each stage that is left out of a kernel is exactly the identity for the
+//  patches that kernel is picked for, so all kernels render the same output
+//  as the ones with every stage turned on.
+//
+//--------------------------------------------------------------------------
+
+/**
+ * Advances the pitch, envelope and sweeps for each sample of a block
+ * Stops after the sample that finishes the sound
+ * @param	length		Maximum number of samples to advance
+ * @return				Number of samples advanced
+ */
+template <bool Filters, bool Flanger, bool Vibrato, bool Repeat, bool PitchChange, bool DutySweep, bool FastMath>
+int SfxrSynth::synthControl (int length)
+{
+    SFXR_PROFILE_START (control);
+
+    _blockSilentFrom = blockSize;
+
+    for (int i = 0; i < length; i++)
+    {
+        // Repeats every _repeatLimit times, partially resetting the sound parameters
+        if constexpr (Repeat)
+        {
+            if (++_repeatTime >= _repeatLimit)
+            {
+                _repeatTime = 0;
+                reset (false);
+            }
+        }
+
+        if constexpr (PitchChange)
+        {
+            _changePeriodTime++;
+            if (_changePeriodTime >= _changePeriod)
+            {
+                _changeTime = 0;
+                _changeTime2 = 0;
+                _changePeriodTime = 0;
+                if (_changeReached)
+                {
+                    _period /= _changeAmount;
+                    _changeReached = false;
+                }
+                if (_changeReached2)
+                {
+                    _period /= _changeAmount2;
+                    _changeReached2 = false;
+                }
+            }
+
+            // If _changeLimit is reached, shifts the pitch
+            if (!_changeReached)
+            {
+                if (++_changeTime >= _changeLimit)
+                {
+                    _changeReached = true;
+                    _period *= _changeAmount;
+                }
+            }
+
+            // If _changeLimit is reached, shifts the pitch
+            if (!_changeReached2)
+            {
+                if (++_changeTime2 >= _changeLimit2)
+                {
+                    _period *= _changeAmount2;
+                    _changeReached2 = true;
+                }
+            }
+        }
+
+        // Acccelerate and apply slide
+        _slide += _deltaSlide;
+        _period *= _slide;
+
+        // Checks for frequency getting too low, and stops the sound if a minFrequency was set
+        if (_period > _maxPeriod)
+        {
+            _period = _maxPeriod;
+            if (_minFreqency > 0.0)
+                _muted = true;
+        }
+
+        _periodTemp = _period;
+
+        // Applies the vibrato effect
+        if constexpr (Vibrato)
+        {
+            _vibratoPhase += _vibratoSpeed;
+
+            if constexpr (FastMath)
+                _periodTemp = _period * (1.0f + SfxrFastMath::sin (_vibratoPhase) * _vibratoAmplitude);
+            else
+                _periodTemp = _period * (1.0f + std::sin (_vibratoPhase) * _vibratoAmplitude);
+        }
+
+        _periodTemp = std::floor (_periodTemp);
+        if (_periodTemp < 8)
+            _periodTemp = 8;
+
+        // Sweeps the square duty
+        if constexpr (DutySweep)
+        {
+            _squareDuty += _dutySweep;
+             if (_squareDuty < 0.0)
+                 _squareDuty = 0.0;
+            else if (_squareDuty > 0.5)
+                _squareDuty = 0.5;
+        }
+
+        // Moves through the different stages of the volume envelope
+        if (++_envelopeTime > _envelopeLength)
+        {
+            _envelopeTime = 0;
+
+            switch (++_envelopeStage)
+            {
+                case 1: _envelopeLength = _envelopeLength1; break;
+                case 2: _envelopeLength = _envelopeLength2; break;
+            }
+        }
+
+        // Sets the volume based on the position in the envelope
+        switch (_envelopeStage)
+        {
+            case 0: _envelopeVolume = _envelopeTime * _envelopeOverLength0;                                        break;
+            case 1: _envelopeVolume = 1.0f + (1.0f - _envelopeTime * _envelopeOverLength1) * 2.0f * _sustainPunch; break;
+            case 2: _envelopeVolume = 1.0f - _envelopeTime * _envelopeOverLength2;                                 break;
+            case 3: _envelopeVolume = 0.0; _finished = true;                                                       break;
+        }
+
+        // Moves the flanger offset
+        if constexpr (Flanger)
+        {
+            _flangerOffset += _flangerDeltaOffset;
+            _flangerInt = int (_flangerOffset);
+
+            if (_flangerInt < 0)
+                _flangerInt = -_flangerInt;
+            else if (_flangerInt > 1023)
+                _flangerInt = 1023;
+
+            _blockFlangerInt[size_t (i)] = _flangerInt;
+        }
+
+        // Moves the high-pass filter cutoff
+        if constexpr (Filters)
+        {
+            if (_hpFilterDeltaCutoff != 0.0)
+            {
+                _hpFilterCutoff *= _hpFilterDeltaCutoff;
+
+                if (_hpFilterCutoff < 0.00001f)
+                    _hpFilterCutoff = 0.00001f;
+                else if (_hpFilterCutoff > 0.1f)
+                    _hpFilterCutoff = 0.1f;
+            }
+
+            _blockHpFilterCutoff[size_t (i)] = _hpFilterCutoff;
+        }
+
+        _blockPeriod[size_t (i)] = _periodTemp;
+        _blockSquareDuty[size_t (i)] = _squareDuty;
+        _blockEnvelopeVolume[size_t (i)] = _envelopeVolume;
+        _blockMuted[size_t (i)] = _muted;
+
+        // The mute lasts to the end, and so does a level below the threshold once the decay is lowering it
+        if (_finishOnSilence && _blockSilentFrom == blockSize
+            && (_muted || (_envelopeStage == 2 && _masterVolume * _envelopeVolume <= _silenceLevel)))
+            _blockSilentFrom = i;
+
+        if (_finished)
+        {
+            SFXR_PROFILE_STOP();
+            SFXR_PROFILE_COUNT (control, i + 1);
+            return i + 1;
+        }
+    }
+
+    SFXR_PROFILE_STOP();
+    SFXR_PROFILE_COUNT (control, length);
+    return length;
+}
+
+/**
+ * Runs the oscillator, filters and flanger _oversampling times per sample and
+ * decimates them into _blockSample
+ * On the SIMD path the oscillator values of a sample are evaluated in one
+ * pass by SfxrOscillator, only the filters and flanger run per sub-sample.
+ * On the wavetable path each oscillator value is read from _wavetable.
+ * Below 8 sub-samples the phase moves on by _phaseStep per sub-sample and the
+ * filter coefficients are stretched to match, see applyOversampling.
+ * The fast math path is the scalar path with the overtone phases wrapped in
+ * integers, which is exact, and SfxrFastMath::tan for the tan wave.
+ * @param	count		Number of samples advanced by synthControl
+ */
+template <unsigned int WaveType, bool Filters, bool Flanger, int Path>
+void SfxrSynth::synthOscillator (int count)
+{
+    constexpr bool Vectorised = Path == oscillatorSimd;
+    constexpr bool FastMath = Path == oscillatorFastMath;
+
+    const int subCount = _oversampling;
+    int subPhases[8] = {};
+    float subSamples[8];
+    float decimatorInput[8];
+
+    SFXR_PROFILE_START (oscillator);
+
+    for (int i = 0; i < count; i++)
+    {
+        SFXR_PROFILE_LAP (oscillator);
+
+        _periodTemp = _blockPeriod[size_t (i)];
+
+        if constexpr (Vectorised)
+        {
+            for (int j = 0; j < subCount; j++)
+            {
+                // Cycles through the period
+                _phase += _phaseStep;
+                if (_phase >= _periodTemp)
+                    _phase = int (_phase - _periodTemp);
+
+                subPhases[j] = _phase;
+            }
+
+            SfxrOscillator::evaluate8<WaveType> (subPhases, _periodTemp, _blockSquareDuty[size_t (i)], _overtones, _overtoneFalloff, subSamples, subCount);
+        }
+
+        // The high-pass decay of _phaseStep steps at 8x
+        float hpFilterFactor = 1.0f;
+        if constexpr (Filters)
+        {
+            hpFilterFactor = 1.0f - _blockHpFilterCutoff[size_t (i)];
+            for (int step = 1; step < _phaseStep; step *= 2)
+                hpFilterFactor *= hpFilterFactor;
+        }
+
+        _superSample = 0.0;
+        for (int j = 0; j < subCount; j++)
+        {
+            if constexpr (Vectorised)
+            {
+                _sample = subSamples[j];
+            }
+            else if constexpr (Path == oscillatorWavetable)
+            {
+                SFXR_PROFILE_LAP (oscillator);
+
+                // Cycles through the period
+                _phase += _phaseStep;
+                if (_phase >= _periodTemp)
+                    _phase = int (_phase - _periodTemp);
+
+                // Interpolates the summed overtones from the table
+                float tempphase = _phase < _periodTemp ? float (_phase) : (float) std::fmod (_phase, _periodTemp);
+                float position = tempphase / _periodTemp * float (wavetableSize);
+                int index = int (position);
+                float fraction = position - float (index);
+                _sample = _wavetable[size_t (index)] + (_wavetable[size_t (index) + 1] - _wavetable[size_t (index)]) * fraction;
+            }
+            else
+            {
+                SFXR_PROFILE_LAP (oscillator);
+
+                // Cycles through the period
+                _phase += _phaseStep;
+                if (_phase >= _periodTemp)
+                {
+                    _phase = int (_phase - _periodTemp);
+
+                    // Moves the noise on to the next period
+                    if constexpr (WaveType == 3 || WaveType == 5)
+                        fillNoise (++_noisePeriod);
+                }
+
+                _sample = 0;
+                float overtonestrength = 1;
+                for (int k = 0; k <= _overtones; k++)
+                {
+                    if (k == 1)
+                        SFXR_PROFILE_LAP (overtones);
+
+                    // _phase and _periodTemp are whole numbers, so the integer remainder is the same as fmod
+                    float tempphase;
+                    if constexpr (FastMath)
+                        tempphase = float ((_phase * (k + 1)) % int (_periodTemp));
+                    else
+                        tempphase = (float) std::fmod ((_phase * (k + 1)), _periodTemp);
+
+                    // Gets the sample from the oscillator
+                    if constexpr (WaveType == 0) // Square wave
+                    {
+                        _sample += overtonestrength * (((tempphase / _periodTemp) < _blockSquareDuty[size_t (i)]) ? 0.5f : -0.5f);
+                    }
+                    else if constexpr (WaveType == 1) // Saw wave
+                    {
+                        _sample += overtonestrength * (1.0f - (tempphase / _periodTemp) * 2.0f);
+                    }
+                    else if constexpr (WaveType == 2) // Sine wave (fast and accurate approx)
+                    {
+                        _pos = tempphase / _periodTemp;
+                        _pos = _pos > 0.5f ? (_pos - 1.0f) * 6.28318531f : _pos * 6.28318531f;
+                        float _tempsample = _pos < 0 ? 1.27323954f * _pos + 0.405284735f * _pos * _pos : 1.27323954f * _pos - 0.405284735f * _pos * _pos;
+                        _sample += overtonestrength * (_tempsample < 0 ? 0.225f * (_tempsample * -_tempsample - _tempsample) + _tempsample : 0.225f * (_tempsample * _tempsample - _tempsample) + _tempsample);
+                    }
+                    else if constexpr (WaveType == 3) // Noise
+                    {
+                        _sample += overtonestrength * _noiseBuffer[(unsigned int)(tempphase * 32 / int (_periodTemp)) % 32];
+                    }
+                    else if constexpr (WaveType == 4) // Triangle Wave
+                    {
+                        _sample += overtonestrength * (std::abs (1 - (tempphase / _periodTemp) * 2) - 1);
+                    }
+                    else if constexpr (WaveType == 5) // Pink Noise
+                    {
+                        _sample += overtonestrength * _noiseBuffer[(unsigned int)(tempphase * 32 / int (_periodTemp)) % 32];
+                    }
+                    else if constexpr (WaveType == 6) // tan
+                    {
+                        //detuned
+                        if constexpr (FastMath)
+                            _sample += SfxrFastMath::tan (float (pi) * tempphase / _periodTemp) * overtonestrength;
+                        else
+                            _sample += std::tan (float (pi) * tempphase / _periodTemp) * overtonestrength;
+                    }
+                    else if constexpr (WaveType == 7) // Whistle
+                    {
+                        // Sin wave code
+                        _pos = tempphase / _periodTemp;
+                        _pos = _pos > 0.5f ? (_pos - 1.0f) * 6.28318531f : _pos * 6.28318531f;
+                        float _tempsample = _pos < 0 ? 1.27323954f * _pos + 0.405284735f * _pos * _pos : 1.27323954f * _pos - 0.405284735f * _pos * _pos;
+                        float value = 0.75f * (_tempsample < 0 ? 0.225f * (_tempsample * -_tempsample - _tempsample) + _tempsample : 0.225f * (_tempsample * _tempsample - _tempsample) + _tempsample);
+                        //then whistle (essentially an overtone with frequencyx20 and amplitude0.25
+
+                        if constexpr (FastMath)
+                            _pos = float (int (tempphase * 20) % int (_periodTemp)) / _periodTemp;
+                        else
+                            _pos = std::fmod ((tempphase * 20), _periodTemp) / _periodTemp;
+                        _pos = _pos > 0.5f ? (_pos - 1.0f) * 6.28318531f : _pos * 6.28318531f;
+                        _tempsample = _pos < 0 ? 1.27323954f * _pos + 0.405284735f * _pos * _pos : 1.27323954f * _pos - 0.405284735f * _pos * _pos;
+                        value += 0.25f * (_tempsample < 0 ? 0.225f * (_tempsample * -_tempsample - _tempsample) + _tempsample : 0.225f * (_tempsample * _tempsample - _tempsample) + _tempsample);
+
+                        _sample += overtonestrength * value;//main wave
+                    }
+                    else if constexpr (WaveType == 8) // Breaker
+                    {
+                        float amp = tempphase / _periodTemp;
+                        _sample += overtonestrength * (std::abs (1 - amp * amp * 2) - 1);
+                    }
+                    overtonestrength *= (1 - _overtoneFalloff);
+                }
+            }
+
+            // Applies the low and high pass filters
+            if constexpr (Filters)
+            {
+                SFXR_PROFILE_LAP (filters);
+
+                _lpFilterOldPos = _lpFilterPos;
+                _lpFilterCutoff *= _lpFilterDeltaCutoff;
+
+                 if (_lpFilterCutoff < 0.0f)
+                     _lpFilterCutoff = 0.0f;
+                else if (_lpFilterCutoff > 0.1f)
+                    _lpFilterCutoff = 0.1f;
+
+                if (_lpFilterOn)
+                {
+                    _lpFilterDeltaPos += (_sample - _lpFilterPos) * std::min (_lpFilterCutoff * _lpFilterCutoffScale, 1.0f);
+                    _lpFilterDeltaPos *= _lpFilterDamping;
+                    flushDenormal (_lpFilterDeltaPos);
+                }
+                else
+                {
+                    _lpFilterPos = _sample;
+                    _lpFilterDeltaPos = 0.0f;
+                }
+
+                _lpFilterPos += _lpFilterDeltaPos;
+                flushDenormal (_lpFilterPos);
+
+                _hpFilterPos += _lpFilterPos - _lpFilterOldPos;
+                _hpFilterPos *= hpFilterFactor;
+                flushDenormal (_hpFilterPos);
+                _sample = _hpFilterPos;
+            }
+
+            // Applies the flanger effect
+            if constexpr (Flanger)
+            {
+                SFXR_PROFILE_LAP (flanger);
+
+                _flangerBuffer[_flangerPos&1023] = _sample;
+                _sample += _flangerBuffer[(_flangerPos - (_blockFlangerInt[size_t (i)] >> _flangerShift) + 1024) & 1023];
+                _flangerPos = (_flangerPos + 1) & 1023;
+            }
+
+            _superSample += _sample;
+            decimatorInput[j] = _sample;
+        }
+
+        SFXR_PROFILE_LAP (decimation);
+
+        // Scaled back up to a sum, so it shares the clipping and averaging with the box filter
+        if (_halfBandDecimation)
+            _superSample = _decimator.process (decimatorInput) * float (subCount);
+
+        // Clipping if too loud
+        if (_superSample > float (subCount))
+            _superSample = float (subCount);
+        else if (_superSample < -float (subCount))
+            _superSample = -float (subCount);
+
+        // Averages out the super samples and applies volumes
+        _blockSample[size_t (i)] = _masterVolume * _blockEnvelopeVolume[size_t (i)] * _superSample * _oversamplingScale;
+    }
+
+    SFXR_PROFILE_STOP();
+    SFXR_PROFILE_COUNT (oscillator, count * subCount);
+    SFXR_PROFILE_COUNT (decimation, count);
+    if constexpr (Path == oscillatorScalar || FastMath)
+        SFXR_PROFILE_COUNT (overtones, count * subCount * _overtones);
+    if constexpr (Filters)
+        SFXR_PROFILE_COUNT (filters, count * subCount);
+    if constexpr (Flanger)
+        SFXR_PROFILE_COUNT (flanger, count * subCount);
+}
+
+/**
+ * Applies the bit crush, compressor and mute to _blockSample and adds it to the buffer
+ * When finishing on silence, stops before the first sample from which the
+ * sound stays silent: from _blockSilentFrom on every new sample is below the
+ * level, so it's silent once the sample held by the bit crush is too.
+ * @param	buffer		Buffer to add the block to
+ * @param	count		Number of samples in the block
+ * @return				Number of samples added, less than count if the sound finished on silence
+ */
+template <bool BitCrush, bool Compression, bool FastMath>
+int SfxrSynth::synthOutput (float* buffer, int count)
+{
+    SFXR_PROFILE_START (bitCrush);
+
+    for (int i = 0; i < count; i++)
+    {
+        SFXR_PROFILE_LAP (bitCrush);
+
+        _superSample = _blockSample[size_t (i)];
+
+        //BIT CRUSH
+        // With no crush or sweep the frequency stays at 1, leaving just the sample and hold
+        _bitcrush_phase += _bitcrush_freq;
+        if (_bitcrush_phase > 1)
+        {
+            _bitcrush_phase = 0;
+            _bitcrush_last = _superSample;
+        }
+
+        if constexpr (BitCrush)
+            _bitcrush_freq = std::max (std::min (_bitcrush_freq + _bitcrush_freq_sweep, 1.0f), 0.0f);
+
+        _superSample = _bitcrush_last;
+
+        if (i >= _blockSilentFrom && (_blockMuted[size_t (i)] || std::abs (_superSample) <= _silenceLevel))
+        {
+            _finished = true;
+            count = i;
+            break;
+        }
+
+        //compressor
+        if constexpr (Compression)
+        {
+            SFXR_PROFILE_LAP (compression);
+
+            if constexpr (FastMath)
+            {
+                if (_superSample > 0)
+                    _superSample = SfxrFastMath::pow (_superSample, _compression_factor);
+                else
+                    _superSample = -SfxrFastMath::pow (-_superSample, _compression_factor);
+            }
+            else
+            {
+                if (_superSample > 0)
+                    _superSample = std::pow (_superSample, _compression_factor);
+                else
+                    _superSample = -std::pow (-_superSample, _compression_factor);
+            }
+        }
+
+        SFXR_PROFILE_LAP (output);
+
+        if (_blockMuted[size_t (i)])
+            _superSample = 0;
+
+        buffer[i] += _superSample;
+    }
+
+    SFXR_PROFILE_STOP();
+    SFXR_PROFILE_COUNT (bitCrush, count);
+    SFXR_PROFILE_COUNT (output, count);
+    if constexpr (Compression)
+        SFXR_PROFILE_COUNT (compression, count);
+
+    return count;
+}
@@ -20,16 +20,51 @@
  */
 #pragma once
 
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <limits>
+
 #include "SfxrParams.h"
+#include "SfxrPatch.h"
+#include "SfxrOscillator.h"
+#include "SfxrNoise.h"
+#include "SfxrDecimator.h"
+#include "SfxrOutputFormat.h"
+#include "SfxrResampler.h"
+#include "SfxrProfile.h"
+#include "SfxrFastMath.h"
 
 class SfxrSynth
 {
 public:
 	SfxrSynth (float sr)
-		: sampleRate (sr)
-	{}
+	{
+		selectKernels (0, featureAll, oscillatorScalar, false);
+		setSampleRate (sr);
+	}
+
+    /** Rate all the timing in the params and patches is relative to, the synth always runs at this rate */
+    static constexpr float internalSampleRate = 44100.0f;
+
+	/**
+	 * Sets the rate of the samples written to the buffer
+	 * At any rate other than internalSampleRate the sound is rendered at
+	 * internalSampleRate and converted by an SfxrResampler as it is written,
+	 * so it keeps the same length and pitch. Allocates, and restarts the
+	 * stream, call before reset (true)
+	 */
+	void setSampleRate (float sr)
+	{
+		sampleRate = sr;
+		_resampling = sr != internalSampleRate;
+		_resampler.setRates (internalSampleRate, sr);
+	}
 
-	void setSampleRate (float sr) { sampleRate = sr; }
+	float getSampleRate() const
+	{
+		return sampleRate;
+	}
     
     //--------------------------------------------------------------------------
     //
@@ -38,538 +73,651 @@ public:
     //--------------------------------------------------------------------------
     
     /** The sound parameters */
-    const SfxrParams& getParams()
+    const SfxrParams& getParams() const
     {
         return _params;
     }
     
-    void setParams (SfxrParams value)
+    void setParams (const SfxrParams& value)
     {
         _params = value;
         _params.paramsDirty = true;
     }
     
+    /**
+     * Sets the seed of the noise waves
+     * Every total reset restarts the noise from this seed, so a sound always renders the same way
+     */
+    void setSeed (uint64_t seed)
+    {
+        _seed = seed;
+    }
+    
+    uint64_t getSeed() const
+    {
+        return _seed;
+    }
+    
     //--------------------------------------------------------------------------
     //
     //  Synth Methods
     //
     //--------------------------------------------------------------------------
     
-    /* Length in quarter-seconds */
-    float getLength()
+    /**
+     * Length in quarter-seconds
+     * Approximate, from the envelope of the compiled patch, so the params
+     * are left unchanged. Use getSampleCount for the exact length.
+     */
+    float getLength() const
+    {
+        const SfxrPatch patch = _params.paramsDirty ? SfxrPatch::compile (_params) : _patch;
+        return (patch.envelopeLength0 + patch.envelopeLength1 + patch.envelopeLength2) * 2 / internalSampleRate;
+    }
+    
+    /**
+     * Exact number of samples the next total reset renders at the sample rate
+     * Counts to the end of the envelope, a sound that finishes on silence can
+     * be shorter, see setFinishOnSilence. The params are compiled into a
+     * copy if they have changed, the synth is left as it was.
+     */
+    size_t getSampleCount() const
     {
-        clampTotalLength();
+        size_t count = _params.paramsDirty ? SfxrPatch::compile (_params).getSampleCount() : _patch.getSampleCount();
         
-        SfxrParams& p = _params;
-        float envelopeLength0 = p.getParam ("attackTime") * p.getParam ("attackTime") * 100000.0f;
-        float envelopeLength1 = p.getParam ("sustainTime") * p.getParam ("sustainTime") * 100000.0f;
-        float envelopeLength2 = p.getParam ("decayTime") * p.getParam ("decayTime") * 100000.0f + 10;
-        return (envelopeLength0 + envelopeLength1 + envelopeLength2) * 2 / (sampleRate);
+        if (_resampling)
+            count = SfxrResampler::getOutputLength (count, internalSampleRate, sampleRate);
+        
+        return count;
+    }
+    
+    /**
+     * Compiles the params into the patch used by reset
+     * The clamped envelope times are written back to the params
+     */
+    void compilePatch()
+    {
+        _patch = SfxrPatch::compile (_params);
 
+        _params.setParam (ParamId::attackTime, _patch.attackTime);
+        _params.setParam (ParamId::sustainTime, _patch.sustainTime);
+        _params.setParam (ParamId::decayTime, _patch.decayTime);
+        _params.paramsDirty = false;
     }
     
     void clampTotalLength()
     {
         SfxrParams& p = _params;
-        float totalTime = p.getParam ("attackTime") + p.getParam ("sustainTime") + p.getParam ("decayTime");
-        if (totalTime < MIN_LENGTH)
+        float totalTime = p.getParam (ParamId::attackTime) + p.getParam (ParamId::sustainTime) + p.getParam (ParamId::decayTime);
+        if (totalTime < SfxrPatch::MIN_LENGTH)
         {
-            float multiplier = MIN_LENGTH / totalTime;
-            p.setParam ("attackTime", p.getParam ("attackTime") * multiplier);
-            p.setParam ("sustainTime", p.getParam ("sustainTime") * multiplier);
-            p.setParam ("decayTime", p.getParam ("decayTime") * multiplier);
+            float multiplier = SfxrPatch::MIN_LENGTH / totalTime;
+            p.setParam (ParamId::attackTime, p.getParam (ParamId::attackTime) * multiplier);
+            p.setParam (ParamId::sustainTime, p.getParam (ParamId::sustainTime) * multiplier);
+            p.setParam (ParamId::decayTime, p.getParam (ParamId::decayTime) * multiplier);
         }
     }
     
     /**
      * Resets the runing variables from the params
      * Used once at the start (total reset) and for the repeat effect (partial reset)
+     * The params are only compiled into the patch when they have changed
      * @param	totalReset	If the reset is total
      */
     void reset (bool totalReset)
     {
+        if (totalReset && _params.paramsDirty)
+            compilePatch();
+
         // Shorter reference
-        SfxrParams& p = _params;
+        const SfxrPatch& p = _patch;
         
-        _period = 100.0f / (p.getParam ("startFrequency") * p.getParam ("startFrequency") + 0.001f);
-        _maxPeriod = 100.0f / (p.getParam ("minFrequency") * p.getParam ("minFrequency") + 0.001f);
+        _period = p.period;
+        _maxPeriod = p.maxPeriod;
 
-        _slide = 1.0f - p.getParam ("slide") * p.getParam ("slide") * p.getParam ("slide") * 0.01f;
-        _deltaSlide = -p.getParam ("deltaSlide") * p.getParam ("deltaSlide") * p.getParam ("deltaSlide") * 0.000001f;
+        _slide = p.slide;
+        _deltaSlide = p.deltaSlide;
         
-        if (int (p.getParam ("waveType")) == 0)
-        {
-            _squareDuty = 0.5f - p.getParam ("squareDuty") * 0.5f;
-            _dutySweep = -p.getParam ("dutySweep") * 0.00005f;
-        }
+        _squareDuty = p.squareDuty;
+        _dutySweep = p.dutySweep;
         
-        _changePeriod = (((1-p.getParam ("changeRepeat")) + 0.1f) / 1.1f) * 20000 + 32;
+        _changePeriod = p.changePeriod;
         _changePeriodTime = 0;
         
-        if (p.getParam ("changeAmount") > 0.0f)
-            _changeAmount = 1.0f - p.getParam ("changeAmount") * p.getParam ("changeAmount") * 0.9f;
-        else
-            _changeAmount = 1.0f + p.getParam ("changeAmount") * p.getParam ("changeAmount") * 10.0f;
-        
+        _changeAmount = p.changeAmount;
         _changeTime = 0;
         _changeReached=false;
+        _changeLimit = p.changeLimit;
         
-        if (p.getParam ("changeSpeed") == 1.0f)
-            _changeLimit = 0;
-        else
-            _changeLimit = int ((1.0f - p.getParam ("changeSpeed")) * (1.0f - p.getParam ("changeSpeed")) * 20000 + 32);
-        
-        
-        if (p.getParam ("changeAmount2") > 0.0)
-            _changeAmount2 = 1.0f - p.getParam ("changeAmount2") * p.getParam ("changeAmount2") * 0.9f;
-        else
-            _changeAmount2 = 1.0f + p.getParam ("changeAmount2") * p.getParam ("changeAmount2") * 10.0f;
-        
+        _changeAmount2 = p.changeAmount2;
         _changeTime2 = 0;
         _changeReached2 = false;
-        
-        if (p.getParam ("changeSpeed2") == 1.0f)
-            _changeLimit2 = 0;
-        else
-            _changeLimit2 = int ((1.0f - p.getParam ("changeSpeed2")) * (1.0f - p.getParam ("changeSpeed2")) * 20000 + 32);
-        
-        _changeLimit  = int (_changeLimit * ((1.0f - p.getParam ("changeRepeat") + 0.1f) / 1.1f));
-        _changeLimit2 = int (_changeLimit2 * ((1.0f - p.getParam ("changeRepeat") + 0.1f) / 1.1f));
+        _changeLimit2 = p.changeLimit2;
         
         if (totalReset)
         {
-            p.paramsDirty = false;
-            
-            _masterVolume = p.getParam ("masterVolume") * p.getParam ("masterVolume");
+            _masterVolume = p.masterVolume;
+            _finished = false;
             
-            _waveType = (unsigned int) (p.getParam ("waveType"));
+            _waveType = p.waveType;
             
-            if (p.getParam ("sustainTime") < 0.01f)
-                p.setParam ("sustainTime", 0.01f);
-            
-            clampTotalLength();
-            
-            _sustainPunch = p.getParam ("sustainPunch");
+            _sustainPunch = p.sustainPunch;
             
             _phase = 0;
             
-            _minFreqency = p.getParam ("minFrequency");
+            _minFreqency = p.minFrequency;
             _muted = false;
-            _overtones = int (p.getParam ("overtones") * 10);
-            _overtoneFalloff = p.getParam ("overtoneFalloff");
+            _overtones = p.overtones;
+            _overtoneFalloff = p.overtoneFalloff;
                 
-            _bitcrush_freq = 1 - std::pow (p.getParam ("bitCrush"), 1.0f / 3.0f);
-            _bitcrush_freq_sweep = - p.getParam ("bitCrushSweep") * 0.000015f;
+            _bitcrush_freq = p.bitcrushFreq;
+            _bitcrush_freq_sweep = p.bitcrushFreqSweep;
             _bitcrush_phase = 0;
             _bitcrush_last = 0;
             
-            _compression_factor = 1 / (1 + 4 * p.getParam ("compressionAmount"));
+            _compression_factor = p.compressionFactor;
             
-            _filters = p.getParam ("lpFilterCutoff") != 1.0f || p.getParam ("hpFilterCutoff") != 0.0;
+            _filters = p.filters;
             
             _lpFilterPos = 0.0f;
             _lpFilterDeltaPos = 0.0f;
-            _lpFilterCutoff = p.getParam ("lpFilterCutoff") * p.getParam ("lpFilterCutoff") * p.getParam ("lpFilterCutoff") * 0.1f;
-            _lpFilterDeltaCutoff = 1.0f + p.getParam ("lpFilterCutoffSweep") * 0.0001f;
-            _lpFilterDamping = 5.0f / (1.0f + p.getParam ("lpFilterResonance") * p.getParam ("lpFilterResonance") * 20.0f) * (0.01f + _lpFilterCutoff);
-            if (_lpFilterDamping > 0.8f) 
-				_lpFilterDamping = 0.8f;
-            _lpFilterDamping = 1.0f - _lpFilterDamping;
-            _lpFilterOn = p.getParam ("lpFilterCutoff") != 1.0;
+            _lpFilterCutoff = p.lpFilterCutoff;
+            _lpFilterDeltaCutoff = p.lpFilterDeltaCutoff;
+            _lpFilterDamping = p.lpFilterDamping;
+            _lpFilterOn = p.lpFilterOn;
             
             _hpFilterPos = 0.0f;
-            _hpFilterCutoff = p.getParam ("hpFilterCutoff") * p.getParam ("hpFilterCutoff") * 0.1f;
-            _hpFilterDeltaCutoff = 1.0f + p.getParam ("hpFilterCutoffSweep") * 0.0003f;
+            _hpFilterCutoff = p.hpFilterCutoff;
+            _hpFilterDeltaCutoff = p.hpFilterDeltaCutoff;
             
             _vibratoPhase = 0.0;
-            _vibratoSpeed = p.getParam ("vibratoSpeed") * p.getParam ("vibratoSpeed") * 0.01f;
-            _vibratoAmplitude = p.getParam ("vibratoDepth") * 0.5f;
+            _vibratoSpeed = p.vibratoSpeed;
+            _vibratoAmplitude = p.vibratoAmplitude;
             
             _envelopeVolume = 0.0f;
             _envelopeStage = 0;
             _envelopeTime = 0.0f;
-            _envelopeLength0 = p.getParam ("attackTime") * p.getParam ("attackTime") * 100000.0f;
-            _envelopeLength1 = p.getParam ("sustainTime") * p.getParam ("sustainTime") * 100000.0f;
-            _envelopeLength2 = p.getParam ("decayTime") * p.getParam ("decayTime") * 100000.0f + 10;
+            _envelopeLength0 = p.envelopeLength0;
+            _envelopeLength1 = p.envelopeLength1;
+            _envelopeLength2 = p.envelopeLength2;
             _envelopeLength = _envelopeLength0;
-            _envelopeFullLength = _envelopeLength0 + _envelopeLength1 + _envelopeLength2;
-            
-            _envelopeOverLength0 = 1.0f / _envelopeLength0;
-            _envelopeOverLength1 = 1.0f / _envelopeLength1;
-            _envelopeOverLength2 = 1.0f / _envelopeLength2;
-            
-            _flanger = p.getParam ("flangerOffset") != 0.0 || p.getParam ("flangerSweep") != 0.0;
+            _envelopeFullLength = p.envelopeFullLength;
             
-            _flangerOffset = p.getParam ("flangerOffset") * p.getParam ("flangerOffset") * 1020.0f;
-            if (p.getParam ("flangerOffset") < 0.0)
-                _flangerOffset = -_flangerOffset;
+            _envelopeOverLength0 = p.envelopeOverLength0;
+            _envelopeOverLength1 = p.envelopeOverLength1;
+            _envelopeOverLength2 = p.envelopeOverLength2;
             
-            _flangerDeltaOffset = p.getParam ("flangerSweep") * p.getParam ("flangerSweep") * p.getParam ("flangerSweep") * 0.2f;
+            _flanger = p.flanger;
+            _flangerOffset = p.flangerOffset;
+            _flangerDeltaOffset = p.flangerDeltaOffset;
             _flangerPos = 0;
             
-            _flangerBuffer.resize (1024);
-            _noiseBuffer.resize (32);
-            _pinkNoiseBuffer.resize (32);
-            _loResNoiseBuffer.resize (32);
-            _pinkNumber = {};
-            
-            for (size_t i = 0; i < 1024; i++)
-                _flangerBuffer[i] = 0.0;
-
-            for (size_t i = 0; i < 32; i++)
-                _noiseBuffer[i] = float (uniformRandom()) * 2.0f - 1.0f;
+            _flangerBuffer.fill (0.0f);
 
-            for (size_t i = 0; i < 32; i++)
-                _pinkNoiseBuffer[i] = float (_pinkNumber.getNextValue());
-
-            for (size_t i = 0; i < 32; i++)
-                _loResNoiseBuffer[i] = ((int (i) % LoResNoisePeriod) == 0) ? float (uniformRandom()) * 2.0f - 1.0f : _loResNoiseBuffer[i - 1];
+            _noiseSeed = SfxrNoise::foldSeed (_seed);
+            _noisePeriod = 0;
+            fillNoise (_noisePeriod);
         
             _repeatTime = 0;
+            _repeatLimit = p.repeatLimit;
             
-            if (p.getParam ("repeatSpeed") == 0.0)
-                _repeatLimit = 0;
-            else
-                _repeatLimit = int ((1.0f - p.getParam ("repeatSpeed")) * (1.0f - p.getParam ("repeatSpeed")) * 20000) + 32;
+            applyOversampling();
+            
+            _resampler.reset();
+            _resamplerFlushed = false;
+            _resampledCount = 0;
+            
+            _ditherRandom.setSeed (_seed);
+            
+            // Compared before the compressor, which raises quiet samples to the power of its factor
+            _finishOnSilence = _finishOnSilenceSetting;
+            _silenceLevel = std::pow (_silenceThreshold, 1.0f / _compression_factor);
+            
+            int oscillatorPath = _simdOscillator ? oscillatorSimd : oscillatorScalar;
+            if (_fastMath && ! (_simdOscillator && SfxrOscillator::isVectorised (_waveType)))
+                oscillatorPath = oscillatorFastMath;
+            
+            if (useHarmonicWavetable (p))
+            {
+                updateWavetable (p);
+                oscillatorPath = oscillatorWavetable;
+            }
+            
+            selectKernels (_waveType, getActiveFeatures (p), oscillatorPath, _fastMath);
         }
     }
     
     /**
      * Writes the wave to the supplied buffer ByteArray
+     * The wave is rendered in blocks by the kernels chosen for the patch at the last total reset
      * @param	buffer		A ByteArray to write the wave to
      * @return				If the wave is finished
      */
     bool synthWave (float* buffer, int start, int length)
     {
+        ScopedFlushDenormals flushDenormals;
+        
+        if (_resampling)
+            return renderResampled (buffer + start, length) < length;
+        
         _finished = false;
         
         _sampleCount = 0;
         _bufferSample = 0.0;
         
-        for (int i = 0; i < length; i++)
+        while (length > 0)
         {
-            if (_finished)
-                return true;
+            int count = (this->*_controlKernel) (std::min (length, blockSize));
+            (this->*_oscillatorKernel) (count);
+            count = (this->*_outputKernel) (buffer + start, count);
             
-            // Repeats every _repeatLimit times, partially resetting the sound parameters
-            if (_repeatLimit != 0)
-            {
-                if (++_repeatTime >= _repeatLimit)
-                {
-                    _repeatTime = 0;
-                    reset (false);
-                }
-            }
+            start += count;
+            length -= count;
             
-            _changePeriodTime++;
-            if (_changePeriodTime >= _changePeriod)
-            {
-                _changeTime = 0;
-                _changeTime2 = 0;
-                _changePeriodTime = 0;
-                if (_changeReached)
-                {
-                    _period /= _changeAmount;
-                    _changeReached = false;
-                }
-                if (_changeReached2)
-                {
-                    _period /= _changeAmount2;
-                    _changeReached2 = false;
-                }
-            }
-            
-            // If _changeLimit is reached, shifts the pitch
-            if (!_changeReached)
-            {
-                if (++_changeTime >= _changeLimit)
-                {
-                    _changeReached = true;
-                    _period *= _changeAmount;
-                }
-            }
-            
-            // If _changeLimit is reached, shifts the pitch
-            if (!_changeReached2)
-            {
-                if (++_changeTime2 >= _changeLimit2)
-                {
-                    _period *= _changeAmount2;
-                    _changeReached2 = true;
-                }
-            }
-            
-            // Acccelerate and apply slide
-            _slide += _deltaSlide;
-            _period *= _slide;
-            
-            // Checks for frequency getting too low, and stops the sound if a minFrequency was set
-            if (_period > _maxPeriod)
-            {
-                _period = _maxPeriod;
-                if (_minFreqency > 0.0)
-                    _muted = true;
-            }
-            
-            _periodTemp = _period;
-            
-            // Applies the vibrato effect
-            if (_vibratoAmplitude > 0.0)
-            {
-                _vibratoPhase += _vibratoSpeed;
-                _periodTemp = _period * (1.0f + std::sin (_vibratoPhase) * _vibratoAmplitude);
-            }
-            
-            _periodTemp = std::floor (_periodTemp);
-            if (_periodTemp < 8)
-                _periodTemp = 8;
+            if (_finished)
+                return length > 0;
+        }
+        
+        return false;
+    }
+    
+    //--------------------------------------------------------------------------
+    //
+    //  Streaming
+    //
+    //  Nothing allocates after construction, so a sound can be rendered from
+    //  an audio callback: setPatch and reset (true) trigger it, then render is
+    //  called once per block and carries on from where the last call stopped.
+    //
+    //--------------------------------------------------------------------------
+    
+    /**
+     * Sets the patch to render from, without copying or compiling params
+     * getParams is left as it was. Takes effect on the next total reset.
+     */
+    void setPatch (const SfxrPatch& patch)
+    {
+        _patch = patch;
+        _params.paramsDirty = false;
+    }
+    
+    /**
+     * Adds the next samples of the sound to the buffer
+     * Unlike synthWave, a finished sound stays finished until the next total reset
+     * @param	buffer		Buffer to add the samples to
+     * @param	length		Number of samples wanted
+     * @return				Number of samples rendered, less than length once the sound has finished
+     */
+    int render (float* buffer, int length)
+    {
+        ScopedFlushDenormals flushDenormals;
+        
+        if (_resampling)
+            return renderResampled (buffer, length);
+        
+        int rendered = 0;
+        
+        while (rendered < length && ! _finished)
+        {
+            int count = (this->*_controlKernel) (std::min (length - rendered, blockSize));
+            (this->*_oscillatorKernel) (count);
+            count = (this->*_outputKernel) (buffer + rendered, count);
             
-            // Sweeps the square duty
-            if (_waveType == 0)
-            {
-                _squareDuty += _dutySweep;
-                 if (_squareDuty < 0.0)
-                     _squareDuty = 0.0;
-                else if (_squareDuty > 0.5)
-                    _squareDuty = 0.5;
-            }
+            rendered += count;
+        }
+        
+        return rendered;
+    }
+    
+    /**
+     * Writes the next samples of the sound to the buffer in another format
+     * Each block is converted as it leaves the output stage, so the sound is
+     * never held as floats outside the synth. Unlike the float render the
+     * frames are written over, not added to.
+     * @param	frames		Buffer to write, numFrames * format.getFrameSize() bytes
+     * @param	numFrames	Number of frames wanted
+     * @param	format		Sample type and layout of the buffer
+     * @return				Number of frames written, less than numFrames once the sound has finished, 0 if the format isn't valid
+     */
+    int render (void* frames, int numFrames, const SfxrOutputFormat& format)
+    {
+        if (! format.isValid())
+            return 0;
+        
+        auto* dest = static_cast<uint8_t*> (frames);
+        const size_t frameSize = size_t (format.getFrameSize());
+        int rendered = 0;
+        
+        while (rendered < numFrames)
+        {
+            _formatBlock.fill (0.0f);
             
-            // Moves through the different stages of the volume envelope
-            if (++_envelopeTime > _envelopeLength)
-            {
-                _envelopeTime = 0;
-                
-                switch (++_envelopeStage)
-                {
-                    case 1: _envelopeLength = _envelopeLength1; break;
-                    case 2: _envelopeLength = _envelopeLength2; break;
-                }
-            }
+            int count = render (_formatBlock.data(), std::min (numFrames - rendered, blockSize));
+            if (count == 0)
+                break;
             
-            // Sets the volume based on the position in the envelope
-            switch (_envelopeStage)
-            {
-                case 0: _envelopeVolume = _envelopeTime * _envelopeOverLength0; 					   				   break;
-                case 1: _envelopeVolume = 1.0f + (1.0f - _envelopeTime * _envelopeOverLength1) * 2.0f * _sustainPunch; break;
-                case 2: _envelopeVolume = 1.0f - _envelopeTime * _envelopeOverLength2; 								   break;
-                case 3: _envelopeVolume = 0.0; _finished = true; 													   break;
-            }
+            SFXR_PROFILE_START (format);
+            format.write (_formatBlock.data(), count, dest + size_t (rendered) * frameSize, _ditherRandom);
+            SFXR_PROFILE_STOP();
+            SFXR_PROFILE_COUNT (format, count);
             
-            // Moves the flanger offset
-            if (_flanger)
+            rendered += count;
+        }
+        
+        return rendered;
+    }
+    
+    /** If the sound has finished, or hasn't been started */
+    bool isFinished() const
+    {
+        return _finished && (! _resampling || (_resamplerFlushed && _resampler.getNumReady() == 0));
+    }
+    
+    //--------------------------------------------------------------------------
+    //
+    //  Kernels
+    //
+    //--------------------------------------------------------------------------
+    
+    /** Stages of the render loop that a kernel can leave out */
+    enum KernelFeature : unsigned int
+    {
+        featureFilters      = 1 << 0,
+        featureFlanger      = 1 << 1,
+        featureVibrato      = 1 << 2,
+        featureRepeat       = 1 << 3,
+        featurePitchChange  = 1 << 4,
+        featureDutySweep    = 1 << 5,
+        featureBitCrush     = 1 << 6,
+        featureCompression  = 1 << 7,
+        
+        featureAll          = (1 << 8) - 1
+    };
+    
+    /**
+     * Sets whether square, saw, sine, triangle and breaker waves use the SIMD oscillator
+     * The output is the same either way, takes effect on the next total reset
+     */
+    void setSimdOscillator (bool enabled)
+    {
+        _simdOscillator = enabled;
+    }
+    
+    /**
+     * Sets whether patches with overtones are rendered from a wavetable of the summed overtones
+     * This makes the cost independent of the number of overtones, at the price of a small
+     * interpolation error. Noise, tan and duty swept square waves are always rendered directly.
+     * Takes effect on the next total reset
+     */
+    void setHarmonicWavetables (bool enabled)
+    {
+        _harmonicWavetables = enabled;
+    }
+    
+    /**
+     * Sets whether the render loop uses the approximations in SfxrFastMath
+     * for the vibrato sin, the tan wave and the compressor's pow, and wraps
+     * the overtone phases of the scalar oscillator in integers rather than
+     * with fmod. The approximations are within a few float roundings of the
+     * libm functions, see SfxrFastMath for their bounds, so the sound is
+     * very close to but not exactly the same as the original.
+     * Takes effect on the next total reset
+     */
+    void setFastMath (bool enabled)
+    {
+        _fastMath = enabled;
+    }
+    
+    /**
+     * Sets whether the sound finishes at its first sample of lasting silence,
+     * rather than rendering it to the end of the envelope
+     * The silence is either the mute once the pitch falls below minFrequency,
+     * or the decay bringing the level, and any sample the bit crush is
+     * holding, to the silence threshold. The render stops before that
+     * sample, so the rest of the sound is never run through the oscillator.
+     * Takes effect on the next total reset
+     */
+    void setFinishOnSilence (bool enabled)
+    {
+        _finishOnSilenceSetting = enabled;
+    }
+    
+    bool getFinishOnSilence() const
+    {
+        return _finishOnSilenceSetting;
+    }
+    
+    /**
+     * Sets the level, after the compressor, that counts as silence for setFinishOnSilence
+     * At 0 only the mute and a decay to nothing count. Levels are measured at
+     * the internal rate, the resampler's ripple can add a little to them.
+     * Takes effect on the next total reset
+     */
+    void setSilenceThreshold (float threshold)
+    {
+        _silenceThreshold = std::max (threshold, 0.0f);
+    }
+    
+    float getSilenceThreshold() const
+    {
+        return _silenceThreshold;
+    }
+    
+    /** Filters that bring the sub-samples down to one sample */
+    enum DecimationFilter
+    {
+        decimateBox,                          // Plain average, the original sound
+        decimateHalfBand                      // Cascade of half-band FIRs, less aliasing
+    };
+    
+    /**
+     * Sets the number of sub-samples rendered per sample, 1, 2, 4 or 8
+     * Cost scales with the factor, 8 is the original sound. Lower factors
+     * alias more, and their filter and flanger coefficients are stretched
+     * to cover the same time, which only approximates the 8x response.
+     * Takes effect on the next total reset
+     */
+    void setOversampling (int factor)
+    {
+        _oversamplingSetting = factor >= 8 ? 8 : factor >= 4 ? 4 : factor >= 2 ? 2 : 1;
+    }
+    
+    int getOversampling() const
+    {
+        return _oversamplingSetting;
+    }
+    
+    /** Sets the filter the sub-samples are decimated with, takes effect on the next total reset */
+    void setDecimationFilter (DecimationFilter filter)
+    {
+        _decimationSetting = filter;
+    }
+    
+    DecimationFilter getDecimationFilter() const
+    {
+        return _decimationSetting;
+    }
+    
+    /** Oscillator implementations, picked per patch by reset */
+    enum OscillatorPath
+    {
+        oscillatorScalar,
+        oscillatorSimd,
+        oscillatorWavetable,
+        oscillatorFastMath                    // Scalar, with the fast math wave functions
+    };
+    
+    /** Returns the stages a patch needs, any stage not returned is a no-op for it */
+    static unsigned int getActiveFeatures (const SfxrPatch& p);
+    
+    //--------------------------------------------------------------------------
+    //
+    //  Profiling
+    //
+    //--------------------------------------------------------------------------
+    
+    /**
+     * Time and invocations of each stage since the last clearProfile
+     * Only counted when built with SFXR_PROFILE defined to 1, see SfxrProfile
+     */
+    const SfxrProfile& getProfile() const
+    {
+        return _profile;
+    }
+    
+    void clearProfile()
+    {
+        _profile.clear();
+    }
+    
+private:
+    friend struct SfxrSynthKernels;
+    
+    using ControlKernel = int (SfxrSynth::*) (int);
+    using OscillatorKernel = void (SfxrSynth::*) (int);
+    using OutputKernel = int (SfxrSynth::*) (float*, int);
+    
+    template <bool Filters, bool Flanger, bool Vibrato, bool Repeat, bool PitchChange, bool DutySweep, bool FastMath>
+    int synthControl (int length);
+    
+    template <unsigned int WaveType, bool Filters, bool Flanger, int Path>
+    void synthOscillator (int count);
+    
+    template <bool BitCrush, bool Compression, bool FastMath>
+    int synthOutput (float* buffer, int count);
+    
+    /**
+     * Renders blocks at internalSampleRate through the resampler until length samples have been added
+     * Once the sound finishes the resampler is flushed, so its last samples aren't cut off
+     */
+    int renderResampled (float* buffer, int length)
+    {
+        SFXR_PROFILE_START (resample);
+        int rendered = _resampler.read (buffer, length);
+        SFXR_PROFILE_STOP();
+        
+        while (rendered < length)
+        {
+            if (_finished)
             {
-                _flangerOffset += _flangerDeltaOffset;
-                _flangerInt = int (_flangerOffset);
+                if (_resamplerFlushed)
+                    break;
                 
-                if (_flangerInt < 0)
-                    _flangerInt = -_flangerInt;
-                else if (_flangerInt > 1023)
-                    _flangerInt = 1023;
-            }
-            
-            // Moves the high-pass filter cutoff
-            if (_filters && _hpFilterDeltaCutoff != 0.0)
-            {
-                _hpFilterCutoff *= _hpFilterDeltaCutoff;
+                // A sound that finished on silence stopped short of its envelope, its last
+                // samples ring on through the filter over the samples it would have rendered
+                const size_t ringOut = std::min (size_t (SfxrResampler::numTaps / 2), _patch.getSampleCount() - _resampledCount);
+                _resampleBlock.fill (0.0f);
+                _resampler.write (_resampleBlock.data(), int (ringOut));
                 
-                if (_hpFilterCutoff < 0.00001f)
-                    _hpFilterCutoff = 0.00001f;
-                else if (_hpFilterCutoff > 0.1f)
-                    _hpFilterCutoff = 0.1f;
+                _resampler.flush();
+                _resamplerFlushed = true;
             }
-            
-            _superSample = 0.0;
-            for (int j = 0; j < 8; j++)
+            else
             {
-                // Cycles through the period
-                _phase++;
-                if (_phase >= _periodTemp)
-                {
-                    _phase = int (_phase - _periodTemp);
-                    
-                    // Generates new random noise for this period
-                    if (_waveType == 3)
-                    {
-                        for (size_t n = 0; n < 32; n++)
-                            _noiseBuffer[n] = float (uniformRandom()) * 2.0f - 1.0f;
-                    }
-                    else if (_waveType == 5)
-                    {
-                        for (size_t n = 0; n < 32; n++)
-                            _pinkNoiseBuffer[n] = float (_pinkNumber.getNextValue());
-                    }
-                    else if (_waveType == 6)
-                    {
-                        for (size_t n = 0; n < 32; n++)
-                            _loResNoiseBuffer[n] = ((int (n) % LoResNoisePeriod) == 0) ? float (uniformRandom()) * 2.0f - 1.0f : _loResNoiseBuffer[n - 1];
-                    }
-                }
+                _resampleBlock.fill (0.0f);
                 
-                _sample = 0;
-                float overtonestrength = 1;
-                for (int k = 0; k <= _overtones; k++)
-                {
-                    float tempphase = (float) std::fmod ((_phase * (k + 1)), _periodTemp);
-                    // Gets the sample from the oscillator
-                    switch (_waveType)
-                    {
-                        case 0: // Square wave
-                        {
-                            _sample += overtonestrength * (((tempphase / _periodTemp) < _squareDuty) ? 0.5f : -0.5f);
-                            break;
-                        }
-                        case 1: // Saw wave
-                        {
-                            _sample += overtonestrength * (1.0f - (tempphase / _periodTemp) * 2.0f);
-                            break;
-                        }
-                        case 2: // Sine wave (fast and accurate approx)
-                        {
-                             _pos = tempphase / _periodTemp;
-                             _pos = _pos > 0.5f ? (_pos - 1.0f) * 6.28318531f : _pos * 6.28318531f;
-                            float _tempsample = _pos < 0 ? 1.27323954f * _pos + 0.405284735f * _pos * _pos : 1.27323954f * _pos - 0.405284735f * _pos * _pos;
-                            _sample += overtonestrength * (_tempsample < 0 ? 0.225f * (_tempsample * -_tempsample - _tempsample) + _tempsample : 0.225f * (_tempsample * _tempsample - _tempsample) + _tempsample);
-                            break;
-                        }
-                        case 3: // Noise
-                        {
-                            _sample += overtonestrength * (_noiseBuffer[(unsigned int)(tempphase * 32 / int (_periodTemp)) % 32]);
-                            break;
-                        }
-                        case 4: // Triangle Wave
-                        {
-                            _sample += overtonestrength * (std::abs (1 - (tempphase / _periodTemp) * 2) - 1);
-                            break;
-                        }
-                        case 5: // Pink Noise
-                        {
-                            _sample += overtonestrength * (_pinkNoiseBuffer [size_t (tempphase * 32 / int (_periodTemp)) % 32]);
-                            break;
-                        }
-                        case 6: // tan
-                        {
-                            //detuned
-                            _sample += std::tan (float (pi) * tempphase / _periodTemp) * overtonestrength;
-                            break;
-                        }
-                        case 7: // Whistle
-                        {
-                            // Sin wave code
-                            _pos = tempphase / _periodTemp;
-                            _pos = _pos > 0.5f ? (_pos - 1.0f) * 6.28318531f : _pos * 6.28318531f;
-                            float _tempsample = _pos < 0 ? 1.27323954f * _pos + 0.405284735f * _pos * _pos : 1.27323954f * _pos - 0.405284735f * _pos * _pos;
-                            float value = 0.75f * (_tempsample < 0 ? 0.225f * (_tempsample * -_tempsample - _tempsample) + _tempsample : 0.225f * (_tempsample * _tempsample - _tempsample) + _tempsample);
-                            //then whistle (essentially an overtone with frequencyx20 and amplitude0.25
-                            
-                            _pos = std::fmod ((tempphase * 20), _periodTemp) / _periodTemp;
-                            _pos = _pos > 0.5f ? (_pos - 1.0f) * 6.28318531f : _pos * 6.28318531f;
-                            _tempsample = _pos < 0 ? 1.27323954f * _pos + 0.405284735f * _pos * _pos : 1.27323954f * _pos - 0.405284735f * _pos * _pos;
-                            value += 0.25f * (_tempsample < 0 ? 0.225f * (_tempsample * -_tempsample - _tempsample) + _tempsample : 0.225f * (_tempsample * _tempsample - _tempsample) + _tempsample);
-                            
-                            _sample += overtonestrength * value;//main wave
-                            
-                            break;
-                        }
-                        case 8: // Breaker
-                        {
-                            float amp = tempphase / _periodTemp;
-                            _sample += overtonestrength * (std::abs (1 - amp * amp * 2) - 1);
-                            break;
-                        }
-                    }
-                    overtonestrength *= (1 - _overtoneFalloff);
-                    
-                }
+                int count = (this->*_controlKernel) (blockSize);
+                (this->*_oscillatorKernel) (count);
+                count = (this->*_outputKernel) (_resampleBlock.data(), count);
                 
-                // Applies the low and high pass filters
-                if (_filters)
-                {
-                    _lpFilterOldPos = _lpFilterPos;
-                    _lpFilterCutoff *= _lpFilterDeltaCutoff;
-                    
-                     if (_lpFilterCutoff < 0.0f)
-                         _lpFilterCutoff = 0.0f;
-                    else if (_lpFilterCutoff > 0.1f)
-                        _lpFilterCutoff = 0.1f;
-                    
-                    if (_lpFilterOn)
-                    {
-                        _lpFilterDeltaPos += (_sample - _lpFilterPos) * _lpFilterCutoff;
-                        _lpFilterDeltaPos *= _lpFilterDamping;
-                    }
-                    else
-                    {
-                        _lpFilterPos = _sample;
-                        _lpFilterDeltaPos = 0.0f;
-                    }
-                    
-                    _lpFilterPos += _lpFilterDeltaPos;
-                    
-                    _hpFilterPos += _lpFilterPos - _lpFilterOldPos;
-                    _hpFilterPos *= 1.0f - _hpFilterCutoff;
-                    _sample = _hpFilterPos;
-                }
+                _resampledCount += size_t (count);
                 
-                // Applies the flanger effect
-                if (_flanger)
-                {
-                    _flangerBuffer[_flangerPos&1023] = _sample;
-                    _sample += _flangerBuffer[(_flangerPos - _flangerInt + 1024) & 1023];
-                    _flangerPos = (_flangerPos + 1) & 1023;
-                }
-                
-                _superSample += _sample;
-            }
-            
-            // Clipping if too loud
-            if (_superSample > 8.0f)
-                _superSample = 8.0f;
-            else if (_superSample < -8.0f)
-                _superSample = -8.0f;
-            
-            // Averages out the super samples and applies volumes
-            _superSample = _masterVolume * _envelopeVolume * _superSample * 0.125f;
-            
-            //BIT CRUSH
-            _bitcrush_phase += _bitcrush_freq;
-            if (_bitcrush_phase > 1)
-            {
-                _bitcrush_phase = 0;
-                _bitcrush_last = _superSample;
+                SFXR_PROFILE_START (resample);
+                _resampler.write (_resampleBlock.data(), count);
+                SFXR_PROFILE_STOP();
+                SFXR_PROFILE_COUNT (resample, count);
             }
             
-            _bitcrush_freq = std::max (std::min (_bitcrush_freq + _bitcrush_freq_sweep, 1.0f), 0.0f);
-            
-            _superSample = _bitcrush_last;
+            SFXR_PROFILE_START (resample);
+            rendered += _resampler.read (buffer + rendered, length - rendered);
+            SFXR_PROFILE_STOP();
+        }
         
-             //compressor
-             if (_superSample > 0)
-                 _superSample = std::pow (_superSample, _compression_factor);
-             else
-                 _superSample = -std::pow (-_superSample, _compression_factor);
-            
-             if (_muted)
-                 _superSample = 0;
-            
-            buffer[start + i] += _superSample;
+        return rendered;
+    }
+    
+    /**
+     * Applies the oversampling settings, called on total reset after the filters are set
+     * Each sub-sample stands for _phaseStep sub-samples at 8x, so the phase
+     * and flanger move on that much further and the filter coefficients that
+     * apply per step are raised to cover that many steps
+     */
+    void applyOversampling()
+    {
+        _oversampling = _oversamplingSetting;
+        _oversamplingScale = 1.0f / float (_oversampling);
+        _phaseStep = 8 / _oversampling;
+        _flangerShift = _phaseStep == 8 ? 3 : _phaseStep == 4 ? 2 : _phaseStep == 2 ? 1 : 0;
+        _lpFilterCutoffScale = float (_phaseStep * _phaseStep);
+        
+        if (_phaseStep > 1)
+        {
+            _lpFilterDeltaCutoff = std::pow (_lpFilterDeltaCutoff, float (_phaseStep));
+            _lpFilterDamping = std::pow (_lpFilterDamping, float (_phaseStep));
         }
         
-        return false;
+        _halfBandDecimation = _decimationSetting == decimateHalfBand;
+        _decimator.setFactor (_oversampling);
+    }
+    
+    /** Picks the kernel for each stage, called on total reset */
+    void selectKernels (unsigned int waveType, unsigned int features, int oscillatorPath, bool fastMath);
+    
+    /**
+     * Zeroes decaying filter state once it turns denormal, where ScopedFlushDenormals can't
+     * Done per sample, so the sound doesn't depend on the lengths it is rendered in
+     */
+    static void flushDenormal (float& value)
+    {
+#if ! SFXR_HAS_MXCSR
+        if (std::abs (value) < std::numeric_limits<float>::min())
+            value = 0.0f;
+#else
+        (void) value;
+#endif
+    }
+    
+    /** Fills _noiseBuffer with the white or pink noise of a period */
+    void fillNoise (uint32_t period)
+    {
+        if (_waveType == 5)
+            SfxrNoise::fillPink (_noiseSeed, period, _noiseBuffer.data());
+        else
+            SfxrNoise::fillWhite (_noiseSeed, period, _noiseBuffer.data());
+    }
+    
+    /** Returns true if the patch should be rendered from a harmonic wavetable */
+    bool useHarmonicWavetable (const SfxrPatch& p) const
+    {
+        return _harmonicWavetables && p.overtones > 0 && SfxrOscillator::hasHarmonicTable (p.waveType)
+            && ! (p.waveType == 0 && p.dutySweep != 0.0f);
+    }
+    
+    /** Fills _wavetable for the patch, unless it already holds the same wave */
+    void updateWavetable (const SfxrPatch& p)
+    {
+        if (_wavetableValid && _wavetableWaveType == p.waveType && _wavetableSquareDuty == p.squareDuty
+            && _wavetableOvertones == p.overtones && _wavetableOvertoneFalloff == p.overtoneFalloff)
+            return;
+        
+        SfxrOscillator::fillHarmonicTable (_wavetable.data(), wavetableSize, p.waveType, p.squareDuty, p.overtones, p.overtoneFalloff);
+        
+        _wavetableValid = true;
+        _wavetableWaveType = p.waveType;
+        _wavetableSquareDuty = p.squareDuty;
+        _wavetableOvertones = p.overtones;
+        _wavetableOvertoneFalloff = p.overtoneFalloff;
     }
     
-private:
     //--------------------------------------------------------------------------
     //
     //  Sound Parameters
     //
     //--------------------------------------------------------------------------
     
-    const float MIN_LENGTH = 0.18f;
-    //should be <32
-    const int LoResNoisePeriod = 8;
-    
 	float sampleRate = 44100.0f;
     SfxrParams _params;                      // Params instance
+    SfxrPatch _patch;                        // Params compiled for reset
     
     //--------------------------------------------------------------------------
     //
@@ -577,7 +725,7 @@ private:
     //
     //--------------------------------------------------------------------------
     
-    bool _finished;                           // If the sound has finished
+    bool _finished = true;                    // If the sound has finished
     
     float _masterVolume;                      // masterVolume * masterVolume (for quick calculations)
     
@@ -639,7 +787,7 @@ private:
     float _flangerDeltaOffset;                // Change in phase offset
     int _flangerInt;                          // Integer flanger offset, for bit maths
     int _flangerPos;                          // Position through the flanger buffer
-    std::vector<float> _flangerBuffer;        // Buffer of wave values used to create the out of phase second wave
+    std::array<float, 1024> _flangerBuffer {}; // Buffer of wave values used to create the out of phase second wave
     
     bool _filters;                            // If the filters are active
     float _lpFilterPos;                       // Adjusted wave position after low-pass filter
@@ -654,11 +802,10 @@ private:
     float _hpFilterCutoff;                    // Cutoff multiplier which adjusts the amount the wave position can move
     float _hpFilterDeltaCutoff;               // Speed of the high-pass cutoff multiplier
     
-    std::vector<float> _noiseBuffer;          // Buffer of random values used to generate noise
-    std::vector<float> _pinkNoiseBuffer;      // Buffer of random values used to generate noise
-    std::vector<float> _loResNoiseBuffer;     // Buffer of random values used to generate noise
-    
-    PinkNumber _pinkNumber;
+    uint64_t _seed = SfxrRandom::getUniqueSeed(); // Seed the noise restarts from on each total reset
+    uint32_t _noiseSeed = 0;                  // Seed folded down for SfxrNoise
+    uint32_t _noisePeriod = 0;                // Number of periods of the noise wave so far
+    std::array<float, SfxrNoise::slotsPerPeriod> _noiseBuffer {}; // Noise values for the current period
     
     float _superSample;                       // Actual sample writen to the wave
     float _sample;                            // Sub-sample calculated 8 times per actual sample, averaged out to get the super sample
@@ -671,4 +818,76 @@ private:
     float _bitcrush_last;                     // last sample value
     
     float _compression_factor;
+    
+    //--------------------------------------------------------------------------
+    //
+    //  Kernel Variables
+    //
+    //--------------------------------------------------------------------------
+    
+    static constexpr int blockSize = 64;      // Samples rendered by each pass of the kernels
+    
+    bool _simdOscillator = true;              // If the oscillator kernel may use SfxrOscillator
+    bool _harmonicWavetables = false;         // If patches with overtones may use _wavetable
+    bool _fastMath = false;                   // If the kernels may use SfxrFastMath
+    
+    bool _finishOnSilenceSetting = false;     // Applied on total reset
+    float _silenceThreshold = 0.0f;
+    bool _finishOnSilence = false;            // If the current sound finishes on silence
+    float _silenceLevel = 0.0f;               // Threshold before the compressor
+    
+    static constexpr int wavetableSize = 2048;
+    std::array<float, wavetableSize + 1> _wavetable; // One period of the wave with its overtones summed
+    bool _wavetableValid = false;             // The wave that _wavetable currently holds
+    unsigned int _wavetableWaveType = 0;
+    float _wavetableSquareDuty = 0.0f;
+    int _wavetableOvertones = 0;
+    float _wavetableOvertoneFalloff = 0.0f;
+    
+    ControlKernel _controlKernel = nullptr;   // Kernels chosen for the patch by selectKernels
+    OscillatorKernel _oscillatorKernel = nullptr;
+    OutputKernel _outputKernel = nullptr;
+    
+    std::array<float, blockSize> _blockPeriod;          // Per sample values written by the control kernel
+    std::array<float, blockSize> _blockSquareDuty;
+    std::array<float, blockSize> _blockEnvelopeVolume;
+    std::array<float, blockSize> _blockHpFilterCutoff;
+    std::array<int, blockSize> _blockFlangerInt;
+    std::array<bool, blockSize> _blockMuted;
+    int _blockSilentFrom = blockSize;                   // First sample of the block past which the envelope or mute keeps the sound silent
+    std::array<float, blockSize> _blockSample;          // Samples from the oscillator kernel, before the output stage
+    
+    SfxrRandom _ditherRandom;                 // Dither of the formatted render, reseeded on each total reset
+    std::array<float, blockSize> _formatBlock; // Block being converted by the formatted render
+    
+    //--------------------------------------------------------------------------
+    //
+    //  Oversampling Variables
+    //
+    //--------------------------------------------------------------------------
+    
+    int _oversamplingSetting = 8;             // Sub-samples per sample, applied on total reset
+    DecimationFilter _decimationSetting = decimateBox;
+    
+    int _oversampling = 8;                    // Sub-samples per sample of the current sound
+    float _oversamplingScale = 0.125f;        // 1 / _oversampling
+    int _phaseStep = 1;                       // Phase moved per sub-sample, the period is always in 8x sub-samples
+    int _flangerShift = 0;                    // Shift from 8x flanger offsets to sub-samples
+    float _lpFilterCutoffScale = 1.0f;        // Low-pass cutoff multiplier for the stretched steps
+    bool _halfBandDecimation = false;         // If _decimator is used instead of the average
+    SfxrDecimator _decimator;
+    
+    //--------------------------------------------------------------------------
+    //
+    //  Resampler Variables
+    //
+    //--------------------------------------------------------------------------
+    
+    bool _resampling = false;                 // If sampleRate isn't internalSampleRate
+    bool _resamplerFlushed = false;           // If the end of the sound has been flushed through the resampler
+    SfxrResampler _resampler;                 // Converts from internalSampleRate to sampleRate
+    size_t _resampledCount = 0;               // Samples written to the resampler since the total reset
+    std::array<float, blockSize> _resampleBlock; // Block of the sound at internalSampleRate
+    
+    SfxrProfile _profile;                     // Stage counters, left at zero unless SFXR_PROFILE is on
 };
@@ -0,0 +1,263 @@
+/**
+ * SfxrVerify
+ *
+ * Copyright 2010 Thomas Vian
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * @author Thomas Vian
+ */
+
+#include "SfxrVerify.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+
+#include "SfxrAnalysis.h"
+#include "SfxrSynth.h"
+
+//--------------------------------------------------------------------------
+//
+//  Comparison
+//
+//--------------------------------------------------------------------------
+
+SfxrVerify::Comparison SfxrVerify::compare (const std::vector<float>& a, const std::vector<float>& b)
+{
+    Comparison result;
+    result.lengthA = a.size();
+    result.lengthB = b.size();
+
+    const size_t length = std::max (a.size(), b.size());
+    if (length == 0)
+        return result;
+
+    double sumSquares = 0.0;
+    for (size_t i = 0; i < length; i++)
+    {
+        float error = std::abs ((i < a.size() ? a[i] : 0.0f) - (i < b.size() ? b[i] : 0.0f));
+        result.maxSampleError = std::max (result.maxSampleError, error);
+        sumSquares += double (error) * error;
+    }
+    result.rmsError = float (std::sqrt (sumSquares / double (length)));
+
+    const auto bandsA = SfxrAnalysis::getSpectrum (a.data(), a.size(), length).bands;
+    const auto bandsB = SfxrAnalysis::getSpectrum (b.data(), b.size(), length).bands;
+
+    double loudest = 0.0;
+    for (size_t i = 0; i < bandsA.size(); i++)
+        loudest = std::max ({ loudest, bandsA[i], bandsB[i] });
+
+    const double floor = loudest * 1.0e-6;
+    for (size_t i = 0; i < bandsA.size(); i++)
+    {
+        if (bandsA[i] < floor && bandsB[i] < floor)
+            continue;
+
+        double difference = 10.0 * std::abs (std::log10 (std::max (bandsA[i], floor) / std::max (bandsB[i], floor)));
+        result.spectralError = std::max (result.spectralError, float (difference));
+    }
+
+    return result;
+}
+
+//--------------------------------------------------------------------------
+//
+//  Coverage Set
+//
+//--------------------------------------------------------------------------
+
+namespace
+{
+    struct Stage
+    {
+        const char* name;
+        std::vector<std::pair<ParamId, float>> settings;
+    };
+
+    const Stage stages[] =
+    {
+        { "slide",          { { ParamId::slide, 0.2f }, { ParamId::deltaSlide, -0.1f }, { ParamId::minFrequency, 0.1f } } },
+        { "overtones",      { { ParamId::overtones, 0.4f }, { ParamId::overtoneFalloff, 0.3f } } },
+        { "filters",        { { ParamId::lpFilterCutoff, 0.4f }, { ParamId::lpFilterCutoffSweep, -0.1f }, { ParamId::lpFilterResonance, 0.5f },
+                              { ParamId::hpFilterCutoff, 0.15f }, { ParamId::hpFilterCutoffSweep, 0.1f } } },
+        { "flanger",        { { ParamId::flangerOffset, 0.2f }, { ParamId::flangerSweep, 0.1f } } },
+        { "vibrato",        { { ParamId::vibratoDepth, 0.4f }, { ParamId::vibratoSpeed, 0.4f } } },
+        { "repeat",         { { ParamId::repeatSpeed, 0.6f } } },
+        { "pitchChange",    { { ParamId::changeRepeat, 0.3f }, { ParamId::changeAmount, 0.5f }, { ParamId::changeSpeed, 0.6f },
+                              { ParamId::changeAmount2, -0.3f }, { ParamId::changeSpeed2, 0.4f } } },
+        { "dutySweep",      { { ParamId::squareDuty, 0.3f }, { ParamId::dutySweep, 0.2f } } },
+        { "bitCrush",       { { ParamId::bitCrush, 0.4f }, { ParamId::bitCrushSweep, 0.1f } } },
+        { "compression",    { { ParamId::compressionAmount, 0.5f } } },
+    };
+}
+
+std::vector<SfxrVerify::Case> SfxrVerify::makeCoverageSet()
+{
+    std::vector<Case> cases;
+
+    for (int waveType = 0; waveType < SfxrParams::WAVETYPECOUNT; waveType++)
+    {
+        SfxrParams base;
+        base.setParam (ParamId::waveType, float (waveType));
+        base.setParam (ParamId::startFrequency, 0.4f);
+        base.setParam (ParamId::attackTime, 0.05f);
+        base.setParam (ParamId::sustainTime, 0.1f);
+        base.setParam (ParamId::sustainPunch, 0.3f);
+        base.setParam (ParamId::decayTime, 0.2f);
+        base.setParam (ParamId::compressionAmount, 0.0f);
+
+        const std::string wave = "wave" + std::to_string (waveType);
+        cases.push_back ({ wave + "-none", base, 0 });
+
+        SfxrParams all = base;
+        for (auto& stage : stages)
+        {
+            SfxrParams params = base;
+            for (auto& setting : stage.settings)
+            {
+                params.setParam (setting.first, setting.second);
+                all.setParam (setting.first, setting.second);
+            }
+
+            cases.push_back ({ wave + "-" + stage.name, params, 0 });
+        }
+
+        cases.push_back ({ wave + "-all", all, 0 });
+    }
+
+    for (size_t i = 0; i < cases.size(); i++)
+        cases[i].seed = i + 1;
+
+    return cases;
+}
+
+void SfxrVerify::configureReference (SfxrSynth& synth)
+{
+    synth.setSampleRate (SfxrSynth::internalSampleRate);
+    synth.setSimdOscillator (false);
+    synth.setHarmonicWavetables (false);
+    synth.setOversampling (8);
+    synth.setDecimationFilter (SfxrSynth::decimateBox);
+}
+
+std::vector<float> SfxrVerify::renderSound (SfxrSynth& synth, const SfxrParams& params, uint64_t seed)
+{
+    synth.setSeed (seed);
+    synth.setParams (params);
+    synth.reset (true);
+
+    std::vector<float> samples;
+    std::vector<float> block (4096);
+
+    for (bool finished = false; ! finished; )
+    {
+        std::fill (block.begin(), block.end(), 0.0f);
+        finished = synth.synthWave (block.data(), 0, int (block.size()));
+        samples.insert (samples.end(), block.begin(), block.end());
+    }
+
+    trimSilence (samples);
+    return samples;
+}
+
+std::vector<float> SfxrVerify::renderReference (const SfxrParams& params, uint64_t seed)
+{
+    SfxrSynth synth (SfxrSynth::internalSampleRate);
+    configureReference (synth);
+    return renderSound (synth, params, seed);
+}
+
+void SfxrVerify::trimSilence (std::vector<float>& samples)
+{
+    while (! samples.empty() && samples.back() == 0.0f)
+        samples.pop_back();
+}
+
+//--------------------------------------------------------------------------
+//
+//  Golden Files
+//
+//  "BFXG", a version, the number of samples, then the samples, all little
+//  endian 32 bit values.
+//
+//--------------------------------------------------------------------------
+
+static const char goldenMagic[4] = { 'B', 'F', 'X', 'G' };
+static const uint32_t goldenVersion = 1;
+
+static void putInt (std::FILE* file, uint32_t value)
+{
+    uint8_t bytes[4] = { uint8_t (value), uint8_t (value >> 8), uint8_t (value >> 16), uint8_t (value >> 24) };
+    std::fwrite (bytes, 1, 4, file);
+}
+
+static bool getInt (std::FILE* file, uint32_t& value)
+{
+    uint8_t bytes[4];
+    if (std::fread (bytes, 1, 4, file) != 4)
+        return false;
+
+    value = uint32_t (bytes[0]) | uint32_t (bytes[1]) << 8 | uint32_t (bytes[2]) << 16 | uint32_t (bytes[3]) << 24;
+    return true;
+}
+
+bool SfxrVerify::writeGolden (const std::string& path, const std::vector<float>& samples)
+{
+    std::FILE* file = std::fopen (path.c_str(), "wb");
+    if (file == nullptr)
+        return false;
+
+    std::fwrite (goldenMagic, 1, 4, file);
+    putInt (file, goldenVersion);
+    putInt (file, uint32_t (samples.size()));
+
+    for (float sample : samples)
+    {
+        uint32_t bits;
+        std::memcpy (&bits, &sample, 4);
+        putInt (file, bits);
+    }
+
+    bool ok = std::ferror (file) == 0;
+    return std::fclose (file) == 0 && ok;
+}
+
+bool SfxrVerify::readGolden (const std::string& path, std::vector<float>& samples)
+{
+    std::FILE* file = std::fopen (path.c_str(), "rb");
+    if (file == nullptr)
+        return false;
+
+    char magic[4];
+    uint32_t version = 0, count = 0;
+    bool ok = std::fread (magic, 1, 4, file) == 4 && std::memcmp (magic, goldenMagic, 4) == 0
+           && getInt (file, version) && version == goldenVersion && getInt (file, count);
+
+    samples.clear();
+    for (uint32_t i = 0; ok && i < count; i++)
+    {
+        uint32_t bits;
+        if (! (ok = getInt (file, bits)))
+            break;
+
+        float sample;
+        std::memcpy (&sample, &bits, 4);
+        samples.push_back (sample);
+    }
+
+    std::fclose (file);
+    return ok;
+}
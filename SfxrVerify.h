@@ -0,0 +1,109 @@
+/**
+ * SfxrVerify
+ *
+ * Copyright 2010 Thomas Vian
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * @author Thomas Vian
+ */
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "SfxrParams.h"
+
+class SfxrSynth;
+
+/**
+ * Checks that optimised render paths still sound like the reference
+ *
+ * The reference is the scalar synthWave at 44100 Hz, 8x oversampling with
+ * the box filter, no SIMD oscillator and no wavetables. Renders are compared
+ * sample by sample and by the energy in each band of their spectrum, so a
+ * path can be held to bit exactness or allowed small phase and rounding
+ * differences that don't change the sound.
+ */
+namespace SfxrVerify
+{
+    /** Largest differences a render may have from the reference */
+    struct Tolerance
+    {
+        float maxSampleError = 1.0e-3f;       // Largest difference of any one sample
+        float maxRmsError = 1.0e-4f;          // Root mean square of the difference
+        float maxSpectralError = 0.5f;        // Largest difference in the energy of any audible band, in dB
+        bool sameLength = true;               // If the renders must have the same number of samples
+    };
+
+    /** Differences between two renders */
+    struct Comparison
+    {
+        size_t lengthA = 0;
+        size_t lengthB = 0;
+        float maxSampleError = 0.0f;
+        float rmsError = 0.0f;
+        float spectralError = 0.0f;
+
+        bool passes (const Tolerance& tolerance) const
+        {
+            return maxSampleError <= tolerance.maxSampleError
+                && rmsError <= tolerance.maxRmsError
+                && spectralError <= tolerance.maxSpectralError
+                && (! tolerance.sameLength || lengthA == lengthB);
+        }
+    };
+
+    /** A patch of the coverage set */
+    struct Case
+    {
+        std::string name;                     // Wave type and stages, usable as a file name
+        SfxrParams params;
+        uint64_t seed = 0;                    // Noise seed
+    };
+
+    /**
+     * Compares two renders, the shorter is taken to be silent past its end
+     * The spectrum is measured in 24 log spaced bands, bands more than 60 dB
+     * below the loudest are ignored
+     */
+    Comparison compare (const std::vector<float>& a, const std::vector<float>& b);
+
+    /**
+     * Patches covering every wave type with no stages, with each stage on its
+     * own and with every stage at once
+     */
+    std::vector<Case> makeCoverageSet();
+
+    /** Sets a synth up to render the reference way */
+    void configureReference (SfxrSynth& synth);
+
+    /**
+     * Renders a sound with synthWave until it finishes
+     * Trailing silence is trimmed, so other paths should be trimmed the same way
+     */
+    std::vector<float> renderSound (SfxrSynth& synth, const SfxrParams& params, uint64_t seed);
+
+    /** Renders a sound the reference way */
+    std::vector<float> renderReference (const SfxrParams& params, uint64_t seed);
+
+    /** Removes the silence from the end of a render */
+    void trimSilence (std::vector<float>& samples);
+
+    /** Writes a render as a golden file, returns false if it can't be written */
+    bool writeGolden (const std::string& path, const std::vector<float>& samples);
+
+    /** Reads a golden file, returns false if it is missing or damaged */
+    bool readGolden (const std::string& path, std::vector<float>& samples);
+}
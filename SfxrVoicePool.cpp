@@ -0,0 +1,169 @@
+/**
+ * SfxrVoicePool
+ *
+ * Copyright 2010 Thomas Vian
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * @author Thomas Vian
+ */
+
+#include "SfxrVoicePool.h"
+
+#include <algorithm>
+
+SfxrVoicePool::SfxrVoicePool (int numVoices, float sampleRate)
+{
+    numVoices = std::max (numVoices, 1);
+
+    _voices.reserve (size_t (numVoices));
+    for (int i = 0; i < numVoices; i++)
+        _voices.emplace_back (sampleRate);
+
+    _active.reserve (size_t (numVoices));
+    _free.reserve (size_t (numVoices));
+    for (int i = numVoices; --i >= 0;)
+        _free.push_back (i);
+}
+
+//--------------------------------------------------------------------------
+//
+//  Getters / Setters
+//
+//--------------------------------------------------------------------------
+
+void SfxrVoicePool::setGain (VoiceId id, float gain)
+{
+    int index = findActive (id);
+    if (index >= 0)
+        _voices[size_t (_active[size_t (index)])].gain = gain;
+}
+
+int SfxrVoicePool::findActive (VoiceId id) const
+{
+    for (size_t i = 0; i < _active.size(); i++)
+        if (_voices[size_t (_active[i])].id == id)
+            return int (i);
+
+    return -1;
+}
+
+//--------------------------------------------------------------------------
+//
+//  Voice Methods
+//
+//--------------------------------------------------------------------------
+
+SfxrVoicePool::VoiceId SfxrVoicePool::trigger (const SfxrPatch& patch, int offset, float gain, int priority)
+{
+    int index = allocateVoice (priority);
+    if (index < 0)
+        return 0;
+
+    Voice& voice = _voices[size_t (index)];
+    voice.id = _nextId++;
+    voice.gain = gain;
+    voice.priority = priority;
+    voice.delay = std::max (offset, 0);
+
+    voice.synth.setPatch (patch);
+    voice.synth.reset (true);
+
+    _active.push_back (index);
+    return voice.id;
+}
+
+int SfxrVoicePool::allocateVoice (int priority)
+{
+    if (! _free.empty())
+    {
+        int index = _free.back();
+        _free.pop_back();
+        return index;
+    }
+
+    if (_stealMode == stealNone || _active.empty())
+        return -1;
+
+    // The active list is oldest first, so the first match is the oldest
+    size_t victim = 0;
+    if (_stealMode == stealLowestPriority)
+    {
+        for (size_t i = 1; i < _active.size(); i++)
+            if (_voices[size_t (_active[i])].priority < _voices[size_t (_active[victim])].priority)
+                victim = i;
+
+        if (_voices[size_t (_active[victim])].priority > priority)
+            return -1;
+    }
+
+    int index = _active[victim];
+    _active.erase (_active.begin() + std::ptrdiff_t (victim));
+    return index;
+}
+
+void SfxrVoicePool::stop (VoiceId id)
+{
+    int index = findActive (id);
+    if (index >= 0)
+        release (size_t (index));
+}
+
+void SfxrVoicePool::stopAll()
+{
+    while (! _active.empty())
+        release (_active.size() - 1);
+}
+
+void SfxrVoicePool::release (size_t activeIndex)
+{
+    _free.push_back (_active[activeIndex]);
+    _active.erase (_active.begin() + std::ptrdiff_t (activeIndex));
+}
+
+void SfxrVoicePool::process (float* buffer, int length)
+{
+    for (size_t i = 0; i < _active.size();)
+    {
+        Voice& voice = _voices[size_t (_active[i])];
+
+        // Waits for the trigger offset
+        int start = std::min (voice.delay, length);
+        voice.delay -= start;
+
+        bool finished = false;
+        while (start < length)
+        {
+            int count = std::min (length - start, scratchSize);
+            std::fill_n (_scratch.begin(), count, 0.0f);
+
+            int rendered = voice.synth.render (_scratch.data(), count);
+            for (int n = 0; n < rendered; n++)
+                buffer[start + n] += _scratch[size_t (n)] * voice.gain;
+
+            start += count;
+
+            // A sound that ends exactly on the chunk boundary is released now, not on the next call
+            if (rendered < count || voice.synth.isFinished())
+            {
+                finished = true;
+                break;
+            }
+        }
+
+        if (finished)
+            release (i);
+        else
+            i++;
+    }
+}
@@ -0,0 +1,153 @@
+/**
+ * SfxrVoicePool
+ *
+ * Copyright 2010 Thomas Vian
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * @author Thomas Vian
+ */
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <vector>
+
+#include "SfxrPatch.h"
+#include "SfxrSynth.h"
+
+/**
+ * Plays many overlapping sounds and mixes them into one output
+ *
+ * All voices are allocated up front, triggering, stopping and processing
+ * never allocate, so the pool can be driven from an audio callback.
+ * Triggers start at a sample offset within the next processed block, and
+ * the cost of processing grows with the number of playing voices, not with
+ * the size of the pool.
+ */
+class SfxrVoicePool
+{
+public:
+    /** How a voice is picked when a sound is triggered and every voice is playing */
+    enum StealMode
+    {
+        stealOldest,                          // Steals the voice that started first
+        stealLowestPriority,                  // Steals the lowest priority voice, the oldest of those on a tie
+        stealNone                             // Drops the new sound
+    };
+
+    /** Identifies a triggered sound, 0 is never used */
+    typedef uint64_t VoiceId;
+
+    /**
+     * @param	numVoices	Most sounds that can play at once
+     * @param	sampleRate	Sample rate of every voice
+     */
+    explicit SfxrVoicePool (int numVoices, float sampleRate = 44100.0f);
+
+    //--------------------------------------------------------------------------
+    //
+    //  Getters / Setters
+    //
+    //--------------------------------------------------------------------------
+
+    void setStealMode (StealMode mode)
+    {
+        _stealMode = mode;
+    }
+
+    StealMode getStealMode() const
+    {
+        return _stealMode;
+    }
+
+    int getNumVoices() const
+    {
+        return int (_voices.size());
+    }
+
+    int getNumActive() const
+    {
+        return int (_active.size());
+    }
+
+    /** Returns true if the sound is still playing or waiting to start */
+    bool isPlaying (VoiceId id) const
+    {
+        return findActive (id) >= 0;
+    }
+
+    /** Sets the gain of a playing sound, from the next processed block */
+    void setGain (VoiceId id, float gain);
+
+    //--------------------------------------------------------------------------
+    //
+    //  Voice Methods
+    //
+    //--------------------------------------------------------------------------
+
+    /**
+     * Starts a sound
+     * @param	patch		Sound to play
+     * @param	offset		Samples into the next processed block the sound starts at
+     * @param	gain		Volume the sound is mixed at
+     * @param	priority	Higher priority sounds are kept when stealing by priority
+     * @return				Id of the sound, 0 if it was dropped
+     */
+    VoiceId trigger (const SfxrPatch& patch, int offset = 0, float gain = 1.0f, int priority = 0);
+
+    /** Stops a sound straight away */
+    void stop (VoiceId id);
+
+    /** Stops every sound straight away */
+    void stopAll();
+
+    /**
+     * Mixes the next block of every playing sound into the buffer
+     * The voices are added to what is already in the buffer
+     * @param	buffer		Buffer to add the sounds to
+     * @param	length		Number of samples
+     */
+    void process (float* buffer, int length);
+
+private:
+    struct Voice
+    {
+        explicit Voice (float sampleRate) : synth (sampleRate) {}
+
+        SfxrSynth synth;
+        VoiceId id = 0;
+        float gain = 1.0f;
+        int priority = 0;
+        int delay = 0;                        // Samples left before the sound starts
+    };
+
+    /** Returns the position in _active of a sound, or -1 */
+    int findActive (VoiceId id) const;
+
+    /** Picks a free voice or one to steal, returns -1 if the sound should be dropped */
+    int allocateVoice (int priority);
+
+    /** Moves a voice from the active list to the free list */
+    void release (size_t activeIndex);
+
+    static constexpr int scratchSize = 256;
+
+    std::vector<Voice> _voices;
+    std::vector<int> _active;                 // Playing voices, oldest first
+    std::vector<int> _free;                   // Voices not playing
+    std::array<float, scratchSize> _scratch;  // A voice's samples before the gain is applied
+
+    StealMode _stealMode = stealOldest;
+    VoiceId _nextId = 1;
+};
@@ -1,10 +1,18 @@
 #include "Util.h"
 
+#include <atomic>
+
+uint64_t SfxrRandom::getUniqueSeed()
+{
+    static const uint64_t base = (uint64_t (std::random_device{}()) << 32) ^ std::random_device{}();
+    static std::atomic<uint64_t> counter {0};
+
+    return base + ++counter * 0x9e3779b97f4a7c15ull;
+}
+
 double uniformRandom()
 {
-    static std::random_device rd;
-    static std::mt19937 e2 {rd()};
-    static std::uniform_real_distribution<> dist {0, 1};
+    thread_local SfxrRandom random;
 
-    return dist (e2);
+    return random.uniform();
 }
@@ -1,7 +1,105 @@
 #pragma once
 
+#include <cstdint>
 #include <random>
 
+#if defined (__SSE__) || defined (_M_X64) || (defined (_M_IX86_FP) && _M_IX86_FP >= 1)
+ #include <xmmintrin.h>
+ #define SFXR_HAS_MXCSR 1
+#endif
+
+/**
+ * Small, fast, seedable random number generator (xoshiro128**)
+ * Each SfxrParams and SfxrSynth owns one, so they can be used from several
+ * threads at once and a sound can be reproduced from its seed.
+ */
+class SfxrRandom
+{
+public:
+    /** Seeds the generator with a different seed for each instance */
+    SfxrRandom()
+    {
+        setSeed (getUniqueSeed());
+    }
+
+    explicit SfxrRandom (uint64_t seed)
+    {
+        setSeed (seed);
+    }
+
+    /** Restarts the sequence from a seed */
+    void setSeed (uint64_t seed)
+    {
+        // splitmix64 spreads the seed over the whole state
+        for (auto& s : state)
+        {
+            seed += 0x9e3779b97f4a7c15ull;
+            uint64_t z = seed;
+            z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+            z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+            s = uint32_t ((z ^ (z >> 31)) >> 32);
+        }
+    }
+
+    /** Returns the next 32 random bits */
+    uint32_t nextInt()
+    {
+        const uint32_t result = rotl (state[1] * 5, 7) * 9;
+        const uint32_t t = state[1] << 9;
+
+        state[2] ^= state[0];
+        state[3] ^= state[1];
+        state[1] ^= state[2];
+        state[0] ^= state[3];
+        state[2] ^= t;
+        state[3] = rotl (state[3], 11);
+
+        return result;
+    }
+
+    /** Returns a random number from 0 up to but not including 1 */
+    double uniform()
+    {
+        return (nextInt() >> 8) * (1.0 / 16777216.0);
+    }
+
+    /** Returns a seed that differs on every call and every run */
+    static uint64_t getUniqueSeed();
+
+private:
+    static uint32_t rotl (uint32_t x, int k)
+    {
+        return (x << k) | (x >> (32 - k));
+    }
+
+    uint32_t state[4];
+};
+
+/**
+ * Sets the FPU to flush denormals to zero for the life of the object, where the
+ * CPU supports it, and restores the previous mode afterwards
+ */
+class ScopedFlushDenormals
+{
+public:
+#if SFXR_HAS_MXCSR
+    ScopedFlushDenormals()
+        : previous (_mm_getcsr())
+    {
+        _mm_setcsr (previous | 0x8040); // Flush to zero and denormals are zero
+    }
+
+    ~ScopedFlushDenormals()
+    {
+        _mm_setcsr (previous);
+    }
+
+private:
+    unsigned int previous;
+#endif
+};
+
+/** Shared per-thread generator, prefer passing an SfxrRandom */
 double uniformRandom();
 
 inline constexpr double pi = 3.14159265358979323846;
@@ -0,0 +1,437 @@
+/**
+ * bfxr-bench
+ *
+ * Copyright 2010 Thomas Vian
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * @author Thomas Vian
+ */
+
+/**
+ * Benchmarks the synth hot path and the parameter API
+ *
+ * usage: bfxr-bench [-t seconds] [-f filter] [-o file.json]
+ *
+ * Each benchmark runs repeatedly for the given time, the fastest of 5 runs
+ * is reported. Results go to stdout as a table and, with -o, to a JSON file
+ * that can be compared across commits. Where the CPU has a time stamp
+ * counter, cycles per unit are reported too: they count TSC ticks, which
+ * run at the nominal clock rather than the boosted one.
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <string>
+#include <vector>
+
+#if defined (_MSC_VER) && (defined (_M_X64) || defined (_M_IX86))
+ #include <intrin.h>
+ #define BFXR_BENCH_TSC 1
+#elif defined (__x86_64__) || defined (__i386__)
+ #include <x86intrin.h>
+ #define BFXR_BENCH_TSC 1
+#endif
+
+#include "SfxrBatch.h"
+#include "SfxrSerialization.h"
+#include "SfxrSynth.h"
+
+//--------------------------------------------------------------------------
+//
+//  Harness
+//
+//--------------------------------------------------------------------------
+
+struct Result
+{
+    std::string name;
+    std::string unit;                         // What each operation produces, a sample or a call
+    double nsPerUnit = 0.0;
+    double cyclesPerUnit = 0.0;               // 0 without a time stamp counter
+};
+
+static uint64_t readCycles()
+{
+   #if BFXR_BENCH_TSC
+    return __rdtsc();
+   #else
+    return 0;
+   #endif
+}
+
+/** Stops the compiler optimising away the work being timed */
+static volatile float sink;
+
+class Bench
+{
+public:
+    Bench (double seconds, std::string filter)
+        : _seconds (seconds), _filter (std::move (filter))
+    {
+    }
+
+    /**
+     * Times a benchmark
+     * @param	name		Name in the results
+     * @param	unit		What one unit is
+     * @param	units		Units produced by each call of run
+     * @param	run			Code to time
+     */
+    void run (const std::string& name, const char* unit, double units, const std::function<void()>& run)
+    {
+        if (! _filter.empty() && name.find (_filter) == std::string::npos)
+            return;
+
+        constexpr int numRuns = 5;
+        const double runSeconds = _seconds / numRuns;
+
+        // Finds how many calls fill a run
+        int calls = 1;
+        for (;;)
+        {
+            auto start = std::chrono::steady_clock::now();
+            for (int i = 0; i < calls; i++)
+                run();
+            double elapsed = std::chrono::duration<double> (std::chrono::steady_clock::now() - start).count();
+
+            if (elapsed >= runSeconds / 4 || calls >= (1 << 28))
+            {
+                calls = std::max (1, int (calls * runSeconds / std::max (elapsed, 1.0e-9)));
+                break;
+            }
+            calls *= 2;
+        }
+
+        Result result { name, unit, 1.0e300, 1.0e300 };
+        for (int r = 0; r < numRuns; r++)
+        {
+            auto start = std::chrono::steady_clock::now();
+            uint64_t startCycles = readCycles();
+
+            for (int i = 0; i < calls; i++)
+                run();
+
+            uint64_t cycles = readCycles() - startCycles;
+            double elapsed = std::chrono::duration<double> (std::chrono::steady_clock::now() - start).count();
+
+            result.nsPerUnit = std::min (result.nsPerUnit, elapsed * 1.0e9 / (calls * units));
+            result.cyclesPerUnit = std::min (result.cyclesPerUnit, double (cycles) / (calls * units));
+        }
+
+        std::printf ("%-36s %12.2f ns/%-6s", name.c_str(), result.nsPerUnit, unit);
+        if (result.cyclesPerUnit > 0.0)
+            std::printf (" %10.1f cycles/%s", result.cyclesPerUnit, unit);
+        std::printf ("\n");
+        std::fflush (stdout);
+
+        _results.push_back (result);
+    }
+
+    bool writeJson (const std::string& path) const
+    {
+        std::FILE* file = std::fopen (path.c_str(), "w");
+        if (file == nullptr)
+            return false;
+
+       #if BFXR_BENCH_TSC
+        const char* cycleCounter = "\"tsc\"";
+       #else
+        const char* cycleCounter = "null";
+       #endif
+
+        std::fprintf (file, "{\n  \"cycleCounter\": %s,\n  \"benchmarks\": [\n", cycleCounter);
+        for (size_t i = 0; i < _results.size(); i++)
+        {
+            const Result& r = _results[i];
+            std::fprintf (file, "    { \"name\": \"%s\", \"unit\": \"%s\", \"nsPerUnit\": %.4f, \"unitsPerSecond\": %.1f, \"cyclesPerUnit\": ",
+                          r.name.c_str(), r.unit.c_str(), r.nsPerUnit, 1.0e9 / r.nsPerUnit);
+
+            if (r.cyclesPerUnit > 0.0)
+                std::fprintf (file, "%.2f }", r.cyclesPerUnit);
+            else
+                std::fprintf (file, "null }");
+
+            std::fprintf (file, i + 1 < _results.size() ? ",\n" : "\n");
+        }
+        std::fprintf (file, "  ]\n}\n");
+
+        return std::fclose (file) == 0;
+    }
+
+private:
+    double _seconds;
+    std::string _filter;
+    std::vector<Result> _results;
+};
+
+//--------------------------------------------------------------------------
+//
+//  Benchmarks
+//
+//--------------------------------------------------------------------------
+
+/** A plain held tone, long enough that a render never reaches the end */
+static SfxrParams makeTone()
+{
+    SfxrParams params;
+    params.setParam (ParamId::sustainTime, 1.0f);
+    params.setParam (ParamId::decayTime, 0.5f);
+    params.setParam (ParamId::compressionAmount, 0.0f);
+    params.setParam (ParamId::waveType, 0.0f);
+    return params;
+}
+
+/** Times rendering a block of samples from the start of the sound */
+static void benchRender (Bench& bench, const std::string& name, const SfxrParams& params, bool fastMath = false)
+{
+    constexpr int length = 32768;
+    static std::vector<float> buffer (length);
+
+    SfxrSynth synth (44100.0f);
+    synth.setFastMath (fastMath);
+    synth.setSeed (1);
+    synth.setParams (params);
+
+    bench.run ("render/" + name, "sample", length, [&]
+    {
+        synth.reset (true);
+        std::fill (buffer.begin(), buffer.end(), 0.0f);
+        synth.render (buffer.data(), length);
+        sink = buffer[length - 1];
+    });
+}
+
+static void benchRendering (Bench& bench)
+{
+    for (int waveType = 0; waveType < SfxrParams::WAVETYPECOUNT; waveType++)
+    {
+        SfxrParams params = makeTone();
+        params.setParam (ParamId::waveType, float (waveType));
+        benchRender (bench, "waveType/" + std::to_string (waveType), params);
+    }
+
+    for (const char* overtones : { "0", "0.5", "1" })
+    {
+        SfxrParams params = makeTone();
+        params.setParam (ParamId::waveType, 1.0f);
+        params.setParam (ParamId::overtones, std::strtof (overtones, nullptr));
+        params.setParam (ParamId::overtoneFalloff, 0.3f);
+        benchRender (bench, std::string ("overtones/") + overtones, params);
+    }
+
+    struct Feature
+    {
+        const char* name;
+        std::vector<std::pair<ParamId, float>> settings;
+    };
+
+    const Feature features[] =
+    {
+        { "filters",        { { ParamId::lpFilterCutoff, 0.5f }, { ParamId::lpFilterResonance, 0.5f }, { ParamId::hpFilterCutoff, 0.1f } } },
+        { "flanger",        { { ParamId::flangerOffset, 0.3f }, { ParamId::flangerSweep, 0.1f } } },
+        { "vibrato",        { { ParamId::vibratoDepth, 0.5f }, { ParamId::vibratoSpeed, 0.5f } } },
+        { "bitcrush",       { { ParamId::bitCrush, 0.5f } } },
+        { "compression",    { { ParamId::compressionAmount, 0.5f } } },
+    };
+
+    for (auto& feature : features)
+    {
+        SfxrParams params = makeTone();
+        benchRender (bench, std::string (feature.name) + "/off", params);
+
+        for (auto& setting : feature.settings)
+            params.setParam (setting.first, setting.second);
+        benchRender (bench, std::string (feature.name) + "/on", params);
+    }
+
+    // The stages SfxrFastMath replaces, rendered both ways
+    const Feature approximated[] =
+    {
+        { "tan",            { { ParamId::waveType, 6.0f }, { ParamId::overtones, 0.5f } } },
+        { "whistle",        { { ParamId::waveType, 7.0f }, { ParamId::overtones, 0.5f } } },
+        { "noise",          { { ParamId::waveType, 3.0f }, { ParamId::overtones, 0.5f } } },
+        { "vibrato",        { { ParamId::vibratoDepth, 0.5f }, { ParamId::vibratoSpeed, 0.5f } } },
+        { "compression",    { { ParamId::compressionAmount, 0.5f } } },
+    };
+
+    for (auto& feature : approximated)
+    {
+        SfxrParams params = makeTone();
+        for (auto& setting : feature.settings)
+            params.setParam (setting.first, setting.second);
+
+        benchRender (bench, std::string ("fastMath/") + feature.name + "/off", params);
+        benchRender (bench, std::string ("fastMath/") + feature.name + "/on", params, true);
+    }
+}
+
+/** Times rendering whole sounds, to the end of the envelope and finishing on silence */
+static void benchSounds (Bench& bench)
+{
+    // Falls below its minimum frequency a third of the way in and is muted for the rest
+    SfxrParams falling = makeTone();
+    falling.setParam (ParamId::startFrequency, 0.5f);
+    falling.setParam (ParamId::slide, -0.25f);
+    falling.setParam (ParamId::minFrequency, 0.25f);
+
+    const std::pair<const char*, SfxrParams> sounds[] = { { "tone", makeTone() }, { "muted", falling } };
+
+    for (auto& sound : sounds)
+    {
+        const double length = double (SfxrBatch::getMaxSampleCount (sound.second));
+
+        bench.run (std::string ("sound/") + sound.first + "/full", "sample", length, [&]
+        {
+            sink = SfxrBatch::renderSound (sound.second, 44100.0f, 1).back();
+        });
+        bench.run (std::string ("sound/") + sound.first + "/finishOnSilence", "sample", length, [&]
+        {
+            sink = SfxrBatch::renderSound (sound.second, 44100.0f, 1, true).back();
+        });
+    }
+}
+
+static void benchResets (Bench& bench)
+{
+    SfxrParams params = makeTone();
+    params.setParam (ParamId::waveType, 1.0f);
+
+    SfxrSynth synth (44100.0f);
+    synth.setParams (params);
+    synth.reset (true);
+
+    bench.run ("reset/total", "call", 1, [&] { synth.reset (true); });
+    bench.run ("reset/repeat", "call", 1, [&] { synth.reset (false); });
+    bench.run ("reset/compile", "call", 1, [&] { synth.compilePatch(); });
+}
+
+static void benchParams (Bench& bench)
+{
+    SfxrParams params;
+    SfxrRandom random (1);
+
+    bench.run ("params/randomize", "call", 1, [&] { params.randomize (random); });
+    bench.run ("params/mutate", "call", 1, [&] { params.mutate (random); });
+
+    bench.run ("params/generate/pickupCoin", "call", 1, [&] { params.generatePickupCoin (random); });
+    bench.run ("params/generate/laserShoot", "call", 1, [&] { params.generateLaserShoot (random); });
+    bench.run ("params/generate/explosion", "call", 1, [&] { params.generateExplosion (random); });
+    bench.run ("params/generate/powerup", "call", 1, [&] { params.generatePowerup (random); });
+    bench.run ("params/generate/hitHurt", "call", 1, [&] { params.generateHitHurt (random); });
+    bench.run ("params/generate/jump", "call", 1, [&] { params.generateJump (random); });
+    bench.run ("params/generate/blipSelect", "call", 1, [&] { params.generateBlipSelect (random); });
+
+    float value = 0.0f;
+    bench.run ("params/setParam/uid", "call", 1, [&]
+    {
+        value = value < 0.5f ? value + 0.01f : 0.0f;
+        params.setParam ("lpFilterResonance", value);
+    });
+    bench.run ("params/setParam/id", "call", 1, [&]
+    {
+        value = value < 0.5f ? value + 0.01f : 0.0f;
+        params.setParam (ParamId::lpFilterResonance, value);
+    });
+
+    sink = params.getParam (ParamId::lpFilterResonance);
+}
+
+static void benchSerialization (Bench& bench)
+{
+    constexpr size_t numPatches = 1000;
+
+    std::vector<SfxrParams> library (numPatches), loaded (numPatches);
+    SfxrRandom random (1);
+    for (SfxrParams& params : library)
+        params.randomize (random);
+
+    for (SfxrSerialization::Encoding encoding : { SfxrSerialization::float32, SfxrSerialization::quantized16 })
+    {
+        const std::string name = encoding == SfxrSerialization::float32 ? "float32" : "quantized16";
+        std::vector<uint8_t> bytes (SfxrSerialization::getEncodedSize (numPatches, encoding));
+
+        bench.run ("serialize/encode/" + name, "patch", numPatches, [&]
+        {
+            SfxrSerialization::encode (library.data(), numPatches, encoding, bytes.data(), bytes.size());
+        });
+        bench.run ("serialize/decode/" + name, "patch", numPatches, [&]
+        {
+            SfxrSerialization::decode (bytes.data(), bytes.size(), loaded.data(), numPatches);
+        });
+    }
+
+    std::vector<char> text (numPatches * (SfxrSerialization::maxStringLength + 1));
+    const size_t length = SfxrSerialization::writeStrings (library.data(), numPatches, text.data(), text.size());
+
+    bench.run ("serialize/writeStrings", "patch", numPatches, [&]
+    {
+        SfxrSerialization::writeStrings (library.data(), numPatches, text.data(), text.size());
+    });
+    bench.run ("serialize/readStrings", "patch", numPatches, [&]
+    {
+        SfxrSerialization::readStrings (std::string_view (text.data(), length), loaded.data(), numPatches);
+    });
+
+    sink = loaded.back().getParam (ParamId::masterVolume);
+}
+
+//--------------------------------------------------------------------------
+//
+//  Main
+//
+//--------------------------------------------------------------------------
+
+int main (int argc, char** argv)
+{
+    double seconds = 0.5;
+    std::string filter, jsonPath;
+
+    for (int i = 1; i < argc; i++)
+    {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+
+        if (arg == "-t" && hasValue)        seconds = std::atof (argv[++i]);
+        else if (arg == "-f" && hasValue)   filter = argv[++i];
+        else if (arg == "-o" && hasValue)   jsonPath = argv[++i];
+        else
+        {
+            std::fprintf (stderr,
+                "usage: bfxr-bench [-t seconds] [-f filter] [-o file.json]\n"
+                "  -t <seconds>   Time spent on each benchmark, default 0.5\n"
+                "  -f <filter>    Only run benchmarks whose name contains this\n"
+                "  -o <file>      Write the results as JSON\n");
+            return 1;
+        }
+    }
+
+    Bench bench (seconds, filter);
+    benchRendering (bench);
+    benchSounds (bench);
+    benchResets (bench);
+    benchParams (bench);
+    benchSerialization (bench);
+
+    if (! jsonPath.empty() && ! bench.writeJson (jsonPath))
+    {
+        std::fprintf (stderr, "%s: can't write file\n", jsonPath.c_str());
+        return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,476 @@
+/**
+ * bfxr-render
+ *
+ * Copyright 2010 Thomas Vian
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * @author Thomas Vian
+ */
+
+/**
+ * Renders the sounds listed in a manifest to WAV files, in parallel
+ *
+ * usage: bfxr-render [options] manifest
+ *
+ * Each line of the manifest is one sound, blank lines and lines starting
+ * with # are skipped:
+ *
+ *     <file.wav> <source> [seed] [param=value ...]
+ *
+ * The source is a generator category (pickupCoin, laserShoot, explosion,
+ * powerup, hitHurt, jump, blipSelect, random) or params to start from the
+ * defaults. Params are then set by uid, as in SfxrParams::setParam. The seed
+ * drives the generator and the noise, and defaults to the line number.
+ *
+ * Sounds are rendered on an SfxrBatch pool and streamed to disk a block at a
+ * time, so memory doesn't grow with the length or number of sounds.
+ *
+ * With -k the sounds are written to an SfxrBank instead, each named by its
+ * file field, for games to map at startup.
+ *
+ * In a build with BFXR_PROFILE on, -p writes the SfxrProfile of each sound
+ * as JSON, most expensive first, to find the patches that render slowly.
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "SfxrBank.h"
+#include "SfxrBatch.h"
+#include "SfxrSynth.h"
+
+//--------------------------------------------------------------------------
+//
+//  Manifest
+//
+//--------------------------------------------------------------------------
+
+struct Sound
+{
+    std::string name;                         // File field of the manifest
+    std::string path;
+    SfxrParams params;
+    uint64_t seed = 0;
+};
+
+/** Sets params from a generator category or the defaults, returns false for an unknown one */
+static bool generate (SfxrParams& params, const std::string& source, uint64_t seed)
+{
+    SfxrRandom random (seed);
+
+    if (source == "params")
+    {
+        params.resetParams();
+        return true;
+    }
+
+    return params.generate (source, random);
+}
+
+/** Reads a manifest, printing the first error and returning false if it has one */
+static bool readManifest (const std::string& path, const std::string& outputDir, std::vector<Sound>& sounds)
+{
+    std::ifstream file (path);
+    if (! file)
+    {
+        std::fprintf (stderr, "%s: can't open manifest\n", path.c_str());
+        return false;
+    }
+
+    std::string line;
+    for (int lineNumber = 1; std::getline (file, line); lineNumber++)
+    {
+        std::istringstream words (line);
+        std::string name, source, word;
+
+        if (! (words >> name) || name[0] == '#')
+            continue;
+
+        auto fail = [&] (const std::string& message)
+        {
+            std::fprintf (stderr, "%s:%d: %s\n", path.c_str(), lineNumber, message.c_str());
+            return false;
+        };
+
+        if (! (words >> source))
+            return fail ("missing source after " + name);
+
+        Sound sound;
+        sound.name = name;
+        sound.path = outputDir.empty() ? name : outputDir + "/" + name;
+        sound.seed = uint64_t (lineNumber);
+
+        std::vector<std::string> settings;
+        while (words >> word)
+        {
+            if (word[0] == '#')
+                break;
+
+            if (word.find ('=') == std::string::npos && settings.empty())
+            {
+                char* end = nullptr;
+                sound.seed = std::strtoull (word.c_str(), &end, 10);
+                if (*end != '\0')
+                    return fail ("bad seed " + word);
+            }
+            else
+            {
+                settings.push_back (word);
+            }
+        }
+
+        if (! generate (sound.params, source, sound.seed))
+            return fail ("unknown source " + source);
+
+        for (auto& setting : settings)
+        {
+            size_t equals = setting.find ('=');
+            if (equals == std::string::npos)
+                return fail ("expected param=value, got " + setting);
+
+            std::string uid = setting.substr (0, equals);
+            if (sound.params.getParamId (uid) == ParamId::count)
+                return fail ("unknown param " + uid);
+
+            char* end = nullptr;
+            float value = std::strtof (setting.c_str() + equals + 1, &end);
+            if (*end != '\0' || end == setting.c_str() + equals + 1)
+                return fail ("bad value for " + uid);
+
+            sound.params.setParam (uid, value);
+        }
+
+        sounds.push_back (std::move (sound));
+    }
+
+    return true;
+}
+
+//--------------------------------------------------------------------------
+//
+//  WAV Writer
+//
+//--------------------------------------------------------------------------
+
+/**
+ * Streams samples to a WAV file
+ * The header is written with empty sizes and filled in by close
+ */
+class WavWriter
+{
+public:
+    ~WavWriter()
+    {
+        close();
+    }
+
+    bool open (const std::string& path, int sampleRate, const SfxrOutputFormat& format)
+    {
+        _file = std::fopen (path.c_str(), "wb");
+        if (_file == nullptr)
+            return false;
+
+        const bool isFloat = format.sampleType == SfxrOutputFormat::float32;
+        const int channels = format.getFrameChannels();
+        const int sampleSize = format.getSampleSize();
+
+        writeTag ("RIFF");
+        write32 (0);
+        writeTag ("WAVE");
+
+        writeTag ("fmt ");
+        write32 (isFloat ? 18 : 16);
+        write16 (isFloat ? 3 : 1);
+        write16 (uint16_t (channels));
+        write32 (uint32_t (sampleRate));
+        write32 (uint32_t (sampleRate * channels * sampleSize));
+        write16 (uint16_t (channels * sampleSize));
+        write16 (uint16_t (sampleSize * 8));
+
+        // Float files need the extension size and a fact chunk
+        if (isFloat)
+        {
+            write16 (0);
+            writeTag ("fact");
+            write32 (4);
+            _factOffset = std::ftell (_file);
+            write32 (0);
+        }
+
+        writeTag ("data");
+        _dataOffset = std::ftell (_file);
+        write32 (0);
+
+        _frameSize = uint32_t (channels * sampleSize);
+        _dataBytes = 0;
+        return true;
+    }
+
+    bool write (const void* data, size_t bytes)
+    {
+        _dataBytes += uint32_t (bytes);
+        return std::fwrite (data, 1, bytes, _file) == bytes;
+    }
+
+    /** Fills in the sizes and closes the file, returns false if anything failed to write */
+    bool close()
+    {
+        if (_file == nullptr)
+            return true;
+
+        // Data chunks are padded to an even length
+        if (_dataBytes & 1)
+            std::fputc (0, _file);
+
+        long end = std::ftell (_file);
+
+        std::fseek (_file, 4, SEEK_SET);
+        write32 (uint32_t (end - 8));
+
+        if (_factOffset != 0)
+        {
+            std::fseek (_file, _factOffset, SEEK_SET);
+            write32 (_dataBytes / _frameSize);
+        }
+
+        std::fseek (_file, _dataOffset, SEEK_SET);
+        write32 (_dataBytes);
+
+        bool ok = std::ferror (_file) == 0;
+        ok = std::fclose (_file) == 0 && ok;
+        _file = nullptr;
+        return ok;
+    }
+
+private:
+    void writeTag (const char* tag)
+    {
+        std::fwrite (tag, 1, 4, _file);
+    }
+
+    void write16 (uint16_t value)
+    {
+        uint8_t bytes[2] = { uint8_t (value), uint8_t (value >> 8) };
+        std::fwrite (bytes, 1, 2, _file);
+    }
+
+    void write32 (uint32_t value)
+    {
+        uint8_t bytes[4] = { uint8_t (value), uint8_t (value >> 8), uint8_t (value >> 16), uint8_t (value >> 24) };
+        std::fwrite (bytes, 1, 4, _file);
+    }
+
+    std::FILE* _file = nullptr;
+    long _factOffset = 0;                     // Position of the frame count in the fact chunk, 0 for none
+    long _dataOffset = 0;                     // Position of the data chunk size
+    uint32_t _frameSize = 0;
+    uint32_t _dataBytes = 0;
+};
+
+//--------------------------------------------------------------------------
+//
+//  Profile
+//
+//--------------------------------------------------------------------------
+
+/** Writes the profile of each sound, sorted by total ticks, and their sum */
+static bool writeProfiles (const std::string& path, const std::vector<Sound>& sounds, const std::vector<SfxrProfile>& profiles)
+{
+    std::FILE* file = std::fopen (path.c_str(), "w");
+    if (file == nullptr)
+        return false;
+
+    std::vector<size_t> order (sounds.size());
+    for (size_t i = 0; i < order.size(); i++)
+        order[i] = i;
+
+    std::stable_sort (order.begin(), order.end(), [&] (size_t a, size_t b)
+    {
+        return profiles[a].getTotalTicks() > profiles[b].getTotalTicks();
+    });
+
+    SfxrProfile total;
+    for (auto& profile : profiles)
+        total += profile;
+
+    std::fprintf (file, "{\n  \"total\": %s,\n  \"sounds\": [\n", total.toJson().c_str());
+    for (size_t i = 0; i < order.size(); i++)
+    {
+        std::fprintf (file, "    { \"file\": \"%s\", \"profile\": %s }%s\n", sounds[order[i]].path.c_str(),
+                      profiles[order[i]].toJson().c_str(), i + 1 < order.size() ? "," : "");
+    }
+    std::fprintf (file, "  ]\n}\n");
+
+    return std::fclose (file) == 0;
+}
+
+//--------------------------------------------------------------------------
+//
+//  Main
+//
+//--------------------------------------------------------------------------
+
+static void printUsage()
+{
+    std::fprintf (stderr,
+        "usage: bfxr-render [options] manifest\n"
+        "  -o <dir>       Directory to write the files to, default the current one\n"
+        "  -j <threads>   Threads to render on, 0 for one per core, default 0\n"
+        "  -r <rate>      Sample rate, default 44100\n"
+        "  -b <bits>      16, 24 or 32 for float, default 16\n"
+        "  -c <channels>  1 or 2, default 1\n"
+        "  -d             Dither 16 and 24 bit samples\n"
+        "  -k <file>      Write the sounds to a bank file instead, mono at the given bits\n"
+        "  -p <file>      Write the render time of each stage per sound as JSON, needs BFXR_PROFILE\n"
+        "  -q             Only print errors\n");
+}
+
+int main (int argc, char** argv)
+{
+    std::string manifest, outputDir, profilePath, bankPath;
+    unsigned int numThreads = 0;
+    int sampleRate = 44100, bits = 16, channels = 1;
+    bool dither = false, quiet = false;
+
+    for (int i = 1; i < argc; i++)
+    {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+
+        if (arg == "-o" && hasValue)        outputDir = argv[++i];
+        else if (arg == "-j" && hasValue)   numThreads = unsigned (std::atoi (argv[++i]));
+        else if (arg == "-r" && hasValue)   sampleRate = std::atoi (argv[++i]);
+        else if (arg == "-b" && hasValue)   bits = std::atoi (argv[++i]);
+        else if (arg == "-c" && hasValue)   channels = std::atoi (argv[++i]);
+        else if (arg == "-d")               dither = true;
+        else if (arg == "-k" && hasValue)   bankPath = argv[++i];
+        else if (arg == "-p" && hasValue)   profilePath = argv[++i];
+        else if (arg == "-q")               quiet = true;
+        else if (arg[0] != '-' && manifest.empty()) manifest = arg;
+        else
+        {
+            printUsage();
+            return 1;
+        }
+    }
+
+    if (manifest.empty() || sampleRate <= 0 || (bits != 16 && bits != 24 && bits != 32) || (channels != 1 && channels != 2))
+    {
+        printUsage();
+        return 1;
+    }
+
+    if (! profilePath.empty() && ! SfxrProfile::enabled)
+    {
+        std::fprintf (stderr, "-p needs a build with BFXR_PROFILE on\n");
+        return 1;
+    }
+
+    std::vector<Sound> sounds;
+    if (! readManifest (manifest, outputDir, sounds))
+        return 1;
+
+    SfxrOutputFormat format;
+    format.sampleType = bits == 16 ? SfxrOutputFormat::int16 : bits == 24 ? SfxrOutputFormat::int24 : SfxrOutputFormat::float32;
+    format.layout = channels == 2 ? SfxrOutputFormat::stereo : SfxrOutputFormat::mono;
+    format.dither = dither;
+
+    if (! bankPath.empty())
+    {
+        std::vector<SfxrBank::Patch> patches;
+        for (auto& sound : sounds)
+            patches.push_back ({ sound.name, sound.params, sound.seed });
+
+        auto start = std::chrono::steady_clock::now();
+        if (! SfxrBank::write (bankPath, patches, float (sampleRate), format.sampleType, numThreads))
+        {
+            std::fprintf (stderr, "%s: can't write file\n", bankPath.c_str());
+            return 1;
+        }
+
+        if (! quiet)
+            std::printf ("Wrote %zu sounds to %s in %.3f s\n", sounds.size(), bankPath.c_str(),
+                         std::chrono::duration<double> (std::chrono::steady_clock::now() - start).count());
+        return 0;
+    }
+
+    std::vector<size_t> lengths;
+    for (auto& sound : sounds)
+        lengths.push_back (SfxrBatch::getMaxSampleCount (sound.params, float (sampleRate)));
+
+    std::vector<SfxrProfile> profiles (sounds.size());
+    std::atomic<uint64_t> totalFrames {0};
+    std::atomic<int> failures {0};
+
+    auto start = std::chrono::steady_clock::now();
+
+    SfxrBatch batch (numThreads);
+    batch.run (lengths, [&] (size_t index)
+    {
+        constexpr int blockFrames = 4096;
+        std::vector<uint8_t> block (size_t (blockFrames * format.getFrameSize()));
+
+        const Sound& sound = sounds[index];
+
+        SfxrSynth synth ((float) sampleRate);
+        synth.setSeed (sound.seed);
+        synth.setParams (sound.params);
+        synth.reset (true);
+
+        WavWriter wav;
+        bool ok = wav.open (sound.path, sampleRate, format);
+
+        uint64_t frames = 0;
+        while (ok && ! synth.isFinished())
+        {
+            int count = synth.render (block.data(), blockFrames, format);
+            ok = wav.write (block.data(), size_t (count * format.getFrameSize()));
+            frames += uint64_t (count);
+        }
+
+        if (! wav.close() || ! ok)
+        {
+            std::fprintf (stderr, "%s: can't write file\n", sound.path.c_str());
+            failures++;
+        }
+
+        profiles[index] = synth.getProfile();
+        totalFrames += frames;
+    });
+
+    double seconds = std::chrono::duration<double> (std::chrono::steady_clock::now() - start).count();
+
+    if (! quiet)
+    {
+        std::printf ("Rendered %zu files, %llu samples in %.3f s on %u threads\n",
+                     sounds.size() - size_t (failures), (unsigned long long) totalFrames, seconds, batch.getNumThreads());
+        std::printf ("%.0f samples/s, %.1f files/s\n", double (totalFrames) / seconds, double (sounds.size()) / seconds);
+    }
+
+    if (! profilePath.empty() && ! writeProfiles (profilePath, sounds, profiles))
+    {
+        std::fprintf (stderr, "%s: can't write file\n", profilePath.c_str());
+        return 1;
+    }
+
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,296 @@
+/**
+ * bfxr-search
+ *
+ * Copyright 2010 Thomas Vian
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * @author Thomas Vian
+ */
+
+/**
+ * Searches for a patch that matches a set of targets, with SfxrSearch
+ *
+ * usage: bfxr-search [options] [source]
+ *
+ * The source is a generator category (pickupCoin, laserShoot, explosion,
+ * powerup, hitHurt, jump, blipSelect, random) or a BFXR string to start
+ * from, default random. The targets are any of a duration, loudness,
+ * spectral centroid and a reference WAV to match the spectrum of, and the
+ * search maximises the sum of their scores. Params locked with -L keep
+ * their values from the source.
+ *
+ * Progress is printed to stderr and the best patch, as a BFXR string, to
+ * stdout.
+ */
+
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "SfxrSearch.h"
+#include "SfxrSerialization.h"
+
+//--------------------------------------------------------------------------
+//
+//  WAV Reader
+//
+//--------------------------------------------------------------------------
+
+static uint32_t readLittleEndian (const uint8_t* data, int numBytes)
+{
+    uint32_t value = 0;
+    for (int i = numBytes - 1; i >= 0; i--)
+        value = value << 8 | data[i];
+    return value;
+}
+
+/** Reads a 16, 24 or 32 bit PCM or 32 bit float WAV file, mixed down to mono */
+static bool readWav (const std::string& path, std::vector<float>& samples, float& sampleRate)
+{
+    std::FILE* file = std::fopen (path.c_str(), "rb");
+    if (file == nullptr)
+        return false;
+
+    std::vector<uint8_t> data;
+    uint8_t block[65536];
+    for (size_t count; (count = std::fread (block, 1, sizeof (block), file)) > 0;)
+        data.insert (data.end(), block, block + count);
+    std::fclose (file);
+
+    if (data.size() < 12 || std::memcmp (data.data(), "RIFF", 4) != 0 || std::memcmp (data.data() + 8, "WAVE", 4) != 0)
+        return false;
+
+    int format = 0, channels = 0, bits = 0;
+    const uint8_t* pcm = nullptr;
+    size_t pcmSize = 0;
+
+    for (size_t position = 12; position + 8 <= data.size();)
+    {
+        const uint8_t* chunk = data.data() + position;
+        const size_t size = std::min (size_t (readLittleEndian (chunk + 4, 4)), data.size() - position - 8);
+
+        if (std::memcmp (chunk, "fmt ", 4) == 0 && size >= 16)
+        {
+            format = int (readLittleEndian (chunk + 8, 2));
+            channels = int (readLittleEndian (chunk + 10, 2));
+            sampleRate = float (readLittleEndian (chunk + 12, 4));
+            bits = int (readLittleEndian (chunk + 22, 2));
+
+            // WAVE_FORMAT_EXTENSIBLE keeps the real format at the start of its sub format GUID
+            if (format == 0xfffe && size >= 26)
+                format = int (readLittleEndian (chunk + 32, 2));
+        }
+        else if (std::memcmp (chunk, "data", 4) == 0)
+        {
+            pcm = chunk + 8;
+            pcmSize = size;
+        }
+
+        position += 8 + size + (size & 1);
+    }
+
+    const bool isFloat = format == 3 && bits == 32;
+    if (pcm == nullptr || channels <= 0 || sampleRate <= 0.0f || ! (isFloat || (format == 1 && (bits == 16 || bits == 24 || bits == 32))))
+        return false;
+
+    const int sampleSize = bits / 8;
+    const size_t numFrames = pcmSize / size_t (sampleSize * channels);
+    samples.assign (numFrames, 0.0f);
+
+    for (size_t i = 0; i < numFrames; i++)
+    {
+        float sum = 0.0f;
+        for (int channel = 0; channel < channels; channel++)
+        {
+            const uint32_t bitsValue = readLittleEndian (pcm + (i * size_t (channels) + size_t (channel)) * size_t (sampleSize), sampleSize);
+
+            if (isFloat)
+            {
+                float value;
+                std::memcpy (&value, &bitsValue, 4);
+                sum += value;
+            }
+            else
+            {
+                // Shift to the top of 32 bits so the sign comes with it
+                sum += float (int32_t (bitsValue << (32 - bits))) / 2147483648.0f;
+            }
+        }
+        samples[i] = sum / float (channels);
+    }
+
+    return true;
+}
+
+//--------------------------------------------------------------------------
+//
+//  Main
+//
+//--------------------------------------------------------------------------
+
+/** Sets params from a generator category or a BFXR string, returns false for neither */
+static bool generate (SfxrParams& params, const std::string& source, uint64_t seed)
+{
+    SfxrRandom random (seed);
+    return params.generate (source, random) || SfxrSerialization::readString (source, params);
+}
+
+static void printUsage()
+{
+    std::fprintf (stderr,
+        "usage: bfxr-search [options] [source]\n"
+        "  -d <seconds>   Target duration\n"
+        "  -l <dB>        Target RMS level in dBFS\n"
+        "  -c <hertz>     Target spectral centroid\n"
+        "  -w <file>      Reference WAV to match the spectrum of, sets the sample rate\n"
+        "  -L <uid>       Lock a param at its value in the source, may be repeated\n"
+        "  -g <count>     Generations, default 100\n"
+        "  -p <count>     Population size, default 64\n"
+        "  -m <seconds>   Longest render of each candidate, 0 for whole sounds, default 0\n"
+        "  -r <rate>      Sample rate, default 44100\n"
+        "  -j <threads>   Threads to render on, 0 for one per core, default 0\n"
+        "  -s <seed>      Seed of the source and the search, default 1\n"
+        "  -q             Only print errors and the result\n");
+}
+
+int main (int argc, char** argv)
+{
+    std::string source = "random", referencePath;
+    std::vector<std::string> locks;
+    std::vector<std::pair<char, float>> targets;
+    unsigned int numThreads = 0;
+    uint64_t generations = 100, seed = 1;
+    float sampleRate = 44100.0f, maxSeconds = 0.0f;
+    bool quiet = false, hasSource = false;
+
+    SfxrSearch::Settings settings;
+
+    for (int i = 1; i < argc; i++)
+    {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+
+        if ((arg == "-d" || arg == "-l" || arg == "-c") && hasValue)
+            targets.push_back ({ arg[1], std::strtof (argv[++i], nullptr) });
+        else if (arg == "-w" && hasValue)   referencePath = argv[++i];
+        else if (arg == "-L" && hasValue)   locks.push_back (argv[++i]);
+        else if (arg == "-g" && hasValue)   generations = std::strtoull (argv[++i], nullptr, 10);
+        else if (arg == "-p" && hasValue)   settings.populationSize = size_t (std::atoi (argv[++i]));
+        else if (arg == "-m" && hasValue)   maxSeconds = std::strtof (argv[++i], nullptr);
+        else if (arg == "-r" && hasValue)   sampleRate = std::strtof (argv[++i], nullptr);
+        else if (arg == "-j" && hasValue)   numThreads = unsigned (std::atoi (argv[++i]));
+        else if (arg == "-s" && hasValue)   seed = std::strtoull (argv[++i], nullptr, 10);
+        else if (arg == "-q")               quiet = true;
+        else if ((arg[0] != '-' || arg.size() == 1 || std::isdigit ((unsigned char) arg[1])) && ! hasSource)
+        {
+            source = arg;
+            hasSource = true;
+        }
+        else
+        {
+            printUsage();
+            return 1;
+        }
+    }
+
+    std::vector<float> reference;
+    if (! referencePath.empty() && ! readWav (referencePath, reference, sampleRate))
+    {
+        std::fprintf (stderr, "%s: can't read WAV file\n", referencePath.c_str());
+        return 1;
+    }
+
+    bool badTarget = false;
+    for (auto& target : targets)
+        badTarget |= target.first != 'l' && ! (target.second > 0.0f);
+
+    if ((targets.empty() && referencePath.empty()) || badTarget || sampleRate <= 0.0f || settings.populationSize == 0)
+    {
+        printUsage();
+        return 1;
+    }
+
+    SfxrParams origin;
+    if (! generate (origin, source, seed))
+    {
+        std::fprintf (stderr, "unknown source %s\n", source.c_str());
+        return 1;
+    }
+
+    for (auto& uid : locks)
+    {
+        if (origin.getParamId (uid) == ParamId::count)
+        {
+            std::fprintf (stderr, "unknown param %s\n", uid.c_str());
+            return 1;
+        }
+        origin.setParamLocked (uid, true);
+    }
+
+    std::vector<SfxrSearch::Fitness> parts;
+    for (auto& target : targets)
+    {
+        if (target.first == 'd')        parts.push_back (SfxrSearch::targetDuration (target.second));
+        else if (target.first == 'l')   parts.push_back (SfxrSearch::targetLoudness (target.second));
+        else                            parts.push_back (SfxrSearch::targetCentroid (target.second));
+    }
+    if (! reference.empty())
+        parts.push_back (SfxrSearch::matchReference (reference));
+
+    settings.sampleRate = sampleRate;
+    settings.maxSamples = size_t (maxSeconds * sampleRate);
+
+    SfxrSearch search ([parts] (const SfxrSearch::Render& render)
+    {
+        float fitness = 0.0f;
+        for (auto& part : parts)
+            fitness += part (render);
+        return fitness;
+    }, settings, numThreads);
+
+    search.setPreview (SfxrSearch::rejectQuiet());
+    search.setSeed (seed);
+
+    auto start = std::chrono::steady_clock::now();
+    search.start (origin);
+
+    for (uint64_t generation = 0; generation < generations; generation++)
+    {
+        search.step();
+
+        if (! quiet && (generation % 10 == 9 || generation + 1 == generations))
+        {
+            double seconds = std::chrono::duration<double> (std::chrono::steady_clock::now() - start).count();
+            std::fprintf (stderr, "generation %llu: best %.4f, %.0f candidates/s\n", (unsigned long long) (generation + 1),
+                          search.getBest().fitness, double (search.getStats().evaluated) / seconds);
+        }
+    }
+
+    if (! quiet)
+    {
+        const auto& stats = search.getStats();
+        double seconds = std::chrono::duration<double> (std::chrono::steady_clock::now() - start).count();
+        std::fprintf (stderr, "Evaluated %llu candidates, %llu rejected, %llu samples in %.3f s\n",
+                      (unsigned long long) stats.evaluated, (unsigned long long) stats.rejected,
+                      (unsigned long long) stats.samplesRendered, seconds);
+    }
+
+    std::printf ("%s\n", SfxrSerialization::toString (search.getBest().params).c_str());
+    return 0;
+}
@@ -0,0 +1,404 @@
+/**
+ * bfxr-verify
+ *
+ * Copyright 2010 Thomas Vian
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * @author Thomas Vian
+ */
+
+/**
+ * Checks render paths against the reference scalar synthWave
+ *
+ * usage:
+ *   bfxr-verify record <dir>               Renders the coverage set to golden files
+ *   bfxr-verify check <dir>                Compares reference renders with the golden files
+ *   bfxr-verify diff <variant> [options]   Compares a render path with the reference
+ *   bfxr-verify math                       Checks the SfxrFastMath error bounds
+ *   bfxr-verify length                     Checks SfxrSynth::getSampleCount against renders
+ *
+ * diff runs the coverage set and then randomly generated patches through
+ * both the reference and the variant and checks each pair against the
+ * variant's tolerance. The exit code is 1 if any case fails.
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <limits>
+#include <string>
+#include <vector>
+
+#include "SfxrMultiSynth.h"
+#include "SfxrSynth.h"
+#include "SfxrVerify.h"
+
+//--------------------------------------------------------------------------
+//
+//  Variants
+//
+//--------------------------------------------------------------------------
+
+struct Variant
+{
+    const char* name;
+    const char* description;
+    SfxrVerify::Tolerance tolerance;
+    std::function<std::vector<float> (const SfxrParams&, uint64_t)> render;
+};
+
+/** Tolerance of a path that must match the reference bit for bit */
+static const SfxrVerify::Tolerance exact { 0.0f, 0.0f, 0.0f, true };
+
+/**
+ * Tolerance of a path that interpolates the wave, which rounds off its sharp edges, so only the rms and spectrum are held close
+ * A tail decaying through the filters underflows to zero a few samples apart, far below audibility, so the lengths may differ
+ */
+static const SfxrVerify::Tolerance interpolated { 2.0f, 0.05f, 3.0f, false };
+
+/**
+ * Tolerance of the fast math approximations
+ * Their error is within a few float roundings, which the filters and
+ * compressor can grow to around 1e-3 on single samples
+ */
+static const SfxrVerify::Tolerance approximated { 0.01f, 1.0e-4f, 0.05f, true };
+
+/** Renders with the reference settings changed by a function */
+static std::function<std::vector<float> (const SfxrParams&, uint64_t)> renderWith (std::function<void (SfxrSynth&)> configure)
+{
+    return [configure] (const SfxrParams& params, uint64_t seed)
+    {
+        SfxrSynth synth (SfxrSynth::internalSampleRate);
+        SfxrVerify::configureReference (synth);
+        configure (synth);
+        return SfxrVerify::renderSound (synth, params, seed);
+    };
+}
+
+static std::vector<float> renderStreaming (const SfxrParams& params, uint64_t seed)
+{
+    SfxrSynth synth (SfxrSynth::internalSampleRate);
+    SfxrVerify::configureReference (synth);
+    synth.setSimdOscillator (true);
+    synth.setSeed (seed);
+    synth.setParams (params);
+    synth.reset (true);
+
+    // An odd block size, so the blocks never line up with synthWave's
+    std::vector<float> samples;
+    while (! synth.isFinished())
+    {
+        size_t start = samples.size();
+        samples.resize (start + 37, 0.0f);
+        samples.resize (start + size_t (synth.render (samples.data() + start, 37)));
+    }
+
+    SfxrVerify::trimSilence (samples);
+    return samples;
+}
+
+static std::vector<float> renderMultiSynth (const SfxrParams& params, uint64_t seed)
+{
+    // Idle lanes play other sounds, so any leaks between lanes show up
+    SfxrRandom random (seed);
+    SfxrParams others[3];
+    others[0].generateExplosion (random);
+    others[1].generateLaserShoot (random);
+    others[2].generatePowerup (random);
+
+    SfxrMultiSynth4 multi;
+    multi.start (0, SfxrPatch::compile (params), seed);
+    for (int l = 1; l < 4; l++)
+        multi.start (l, SfxrPatch::compile (others[l - 1]), seed + uint64_t (l));
+
+    std::vector<float> samples, discard (4096);
+    while (multi.isActive (0))
+    {
+        size_t start = samples.size();
+        samples.resize (start + 4096, 0.0f);
+
+        float* outputs[4] = { samples.data() + start, discard.data(), discard.data(), discard.data() };
+        multi.render (outputs, 4096);
+    }
+
+    SfxrVerify::trimSilence (samples);
+    return samples;
+}
+
+static const std::vector<Variant>& getVariants()
+{
+    static const std::vector<Variant> variants =
+    {
+        { "simd",       "SIMD oscillator",                              exact,      renderWith ([] (SfxrSynth& s) { s.setSimdOscillator (true); }) },
+        { "wavetable",  "Harmonic wavetables",                          interpolated, renderWith ([] (SfxrSynth& s) { s.setHarmonicWavetables (true); }) },
+        { "stream",     "Streaming render in 37 sample blocks",         exact,      renderStreaming },
+        { "multi",      "SfxrMultiSynth4 lane",                         exact,      renderMultiSynth },
+        { "fastmath",   "Fast math approximations",                     approximated, renderWith ([] (SfxrSynth& s) { s.setFastMath (true); }) },
+        { "silence",    "Finishing on silence",                         exact,      renderWith ([] (SfxrSynth& s) { s.setFinishOnSilence (true); }) },
+    };
+
+    return variants;
+}
+
+//--------------------------------------------------------------------------
+//
+//  Commands
+//
+//--------------------------------------------------------------------------
+
+static void printComparison (const char* result, const std::string& name, const SfxrVerify::Comparison& c)
+{
+    std::printf ("%-4s %-28s length %zu/%zu  max %.3g  rms %.3g  spectrum %.3g dB\n",
+                 result, name.c_str(), c.lengthA, c.lengthB, c.maxSampleError, c.rmsError, c.spectralError);
+}
+
+static int record (const std::string& dir)
+{
+    for (auto& c : SfxrVerify::makeCoverageSet())
+    {
+        std::string path = dir + "/" + c.name + ".golden";
+        if (! SfxrVerify::writeGolden (path, SfxrVerify::renderReference (c.params, c.seed)))
+        {
+            std::fprintf (stderr, "%s: can't write file\n", path.c_str());
+            return 1;
+        }
+    }
+
+    std::printf ("Recorded %zu golden files\n", SfxrVerify::makeCoverageSet().size());
+    return 0;
+}
+
+static int check (const std::string& dir, bool verbose)
+{
+    int failures = 0, count = 0;
+
+    for (auto& c : SfxrVerify::makeCoverageSet())
+    {
+        std::string path = dir + "/" + c.name + ".golden";
+        std::vector<float> golden;
+        count++;
+
+        if (! SfxrVerify::readGolden (path, golden))
+        {
+            std::printf ("FAIL %-28s missing or damaged golden file\n", c.name.c_str());
+            failures++;
+            continue;
+        }
+
+        auto comparison = SfxrVerify::compare (golden, SfxrVerify::renderReference (c.params, c.seed));
+        bool passed = comparison.passes (SfxrVerify::Tolerance());
+        failures += passed ? 0 : 1;
+
+        if (verbose || ! passed)
+            printComparison (passed ? "ok" : "FAIL", c.name, comparison);
+    }
+
+    std::printf ("%d of %d cases match the golden files\n", count - failures, count);
+    return failures == 0 ? 0 : 1;
+}
+
+/** Returns the coverage set followed by randomly generated patches */
+static std::vector<SfxrVerify::Case> makeCases (int numRandom, uint64_t seed)
+{
+    std::vector<SfxrVerify::Case> cases = SfxrVerify::makeCoverageSet();
+
+    for (int i = 0; i < numRandom; i++)
+    {
+        SfxrRandom random (seed + uint64_t (i));
+        SfxrVerify::Case c;
+        c.name = "random" + std::to_string (i);
+        c.seed = seed + uint64_t (i);
+
+        switch (i % 4)
+        {
+            case 0:     c.params.randomize (random); break;
+            case 1:     c.params.randomize (random); c.params.mutate (random, 0.2f); break;
+            case 2:     c.params.generateExplosion (random); break;
+            default:    c.params.generateLaserShoot (random); break;
+        }
+
+        cases.push_back (c);
+    }
+
+    return cases;
+}
+
+static int diff (const Variant& variant, int numRandom, uint64_t seed, bool verbose)
+{
+    std::vector<SfxrVerify::Case> cases = makeCases (numRandom, seed);
+
+    int failures = 0;
+    for (auto& c : cases)
+    {
+        auto comparison = SfxrVerify::compare (SfxrVerify::renderReference (c.params, c.seed), variant.render (c.params, c.seed));
+        bool passed = comparison.passes (variant.tolerance);
+        failures += passed ? 0 : 1;
+
+        if (verbose || ! passed)
+            printComparison (passed ? "ok" : "FAIL", c.name, comparison);
+    }
+
+    std::printf ("%s: %zu of %zu cases within tolerance\n", variant.name, cases.size() - size_t (failures), cases.size());
+    return failures == 0 ? 0 : 1;
+}
+
+/** Sweeps each SfxrFastMath function over its documented range against libm in doubles */
+static int checkFastMath()
+{
+    int failures = 0;
+
+    auto report = [&failures] (const char* name, double error, double bound)
+    {
+        bool passed = error <= bound;
+        failures += passed ? 0 : 1;
+        std::printf ("%-4s %-8s worst error %.3g, bound %.3g\n", passed ? "ok" : "FAIL", name, error, bound);
+    };
+
+    double sinError = 0.0;
+    for (int i = 0; i <= 4000000; i++)
+    {
+        float x = -8192.0f + 16384.0f * float (i) / 4000000.0f;
+        sinError = std::max (sinError, std::abs (double (SfxrFastMath::sin (x)) - std::sin (double (x))));
+    }
+    report ("sin", sinError, SfxrFastMath::sinMaxError);
+
+    // Every phase of the periods the tan wave plays at
+    double tanError = 0.0;
+    for (int period = 8; period <= 100000; period += period < 1024 ? 1 : 251)
+    {
+        for (int phase = 0; phase < period; phase++)
+        {
+            float x = float (pi) * float (phase) / float (period);
+            double reference = std::tan (double (x));
+            tanError = std::max (tanError, std::abs (double (SfxrFastMath::tan (x)) - reference) / std::max (std::abs (reference), 1.0e-30));
+        }
+    }
+    report ("tan", tanError, SfxrFastMath::tanMaxRelativeError);
+
+    double powError = 0.0;
+    for (int i = 0; i <= 100; i++)
+    {
+        float y = float (i) / 100.0f;
+        for (float x = std::numeric_limits<float>::min(); x < 4.0f; x *= 1.001f)
+        {
+            double reference = std::pow (double (x), double (y));
+            powError = std::max (powError, std::abs (double (SfxrFastMath::pow (x, y)) - reference) / reference);
+        }
+    }
+    report ("pow", powError, SfxrFastMath::powMaxRelativeError);
+
+    return failures == 0 ? 0 : 1;
+}
+
+/** Renders each case at several rates and checks it's exactly as long as getSampleCount said */
+static int checkLengths()
+{
+    std::vector<SfxrVerify::Case> cases = makeCases (200, 1);
+    int count = 0, failures = 0;
+
+    for (float sampleRate : { 44100.0f, 48000.0f, 22050.0f })
+    {
+        for (auto& c : cases)
+        {
+            SfxrSynth synth (sampleRate);
+            synth.setSeed (c.seed);
+            synth.setParams (c.params);
+
+            const size_t expected = synth.getSampleCount();
+            synth.reset (true);
+
+            std::vector<float> block (1000);
+            size_t rendered = 0;
+            while (! synth.isFinished())
+                rendered += size_t (synth.render (block.data(), int (block.size())));
+
+            count++;
+            if (rendered != expected)
+            {
+                failures++;
+                std::printf ("FAIL %-28s %6.0f Hz rendered %zu samples, expected %zu\n", c.name.c_str(), sampleRate, rendered, expected);
+            }
+        }
+    }
+
+    std::printf ("%d of %d renders are the expected length\n", count - failures, count);
+    return failures == 0 ? 0 : 1;
+}
+
+static int printUsage()
+{
+    std::fprintf (stderr,
+        "usage:\n"
+        "  bfxr-verify record <dir>               Renders the coverage set to golden files\n"
+        "  bfxr-verify check <dir> [-v]           Compares reference renders with the golden files\n"
+        "  bfxr-verify diff <variant> [options]   Compares a render path with the reference\n"
+        "  bfxr-verify math                       Checks the SfxrFastMath error bounds\n"
+        "  bfxr-verify length                     Checks SfxrSynth::getSampleCount against renders\n"
+        "    -n <count>   Random patches after the coverage set, default 200\n"
+        "    -s <seed>    Seed of the first random patch, default 1\n"
+        "    -v           Print every case, not just failures\n"
+        "variants:\n");
+
+    for (auto& variant : getVariants())
+        std::fprintf (stderr, "  %-12s %s\n", variant.name, variant.description);
+
+    return 1;
+}
+
+int main (int argc, char** argv)
+{
+    if (argc == 2 && std::string (argv[1]) == "math")
+        return checkFastMath();
+
+    if (argc == 2 && std::string (argv[1]) == "length")
+        return checkLengths();
+
+    if (argc < 3)
+        return printUsage();
+
+    std::string command = argv[1], target = argv[2];
+    int numRandom = 200;
+    uint64_t seed = 1;
+    bool verbose = false;
+
+    for (int i = 3; i < argc; i++)
+    {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+
+        if (arg == "-n" && hasValue)        numRandom = std::atoi (argv[++i]);
+        else if (arg == "-s" && hasValue)   seed = std::strtoull (argv[++i], nullptr, 10);
+        else if (arg == "-v")               verbose = true;
+        else                                return printUsage();
+    }
+
+    if (command == "record")
+        return record (target);
+
+    if (command == "check")
+        return check (target, verbose);
+
+    if (command == "diff")
+    {
+        for (auto& variant : getVariants())
+            if (target == variant.name)
+                return diff (variant, numRandom, seed, verbose);
+
+        std::fprintf (stderr, "unknown variant %s\n", target.c_str());
+    }
+
+    return printUsage();
+}